@@ -7,6 +7,9 @@ struct buf {
   struct buf *prev; // LRU cache list
   struct buf *next;
   struct buf *qnext; // disk queue
+  char **pages;      // swap I/O: pages to transfer instead of data
+  uint nsect;        // swap I/O: number of sectors
+  uint done;         // swap I/O: sectors transferred so far
   uchar data[BSIZE];
 };
 #define B_VALID 0x2  // buffer has been read from disk
@@ -235,11 +235,17 @@ consoleintr(int (*getc)(void))
 int
 consoleread(struct inode *ip, char *dst, int n)
 {
+  char buf[INPUT_BUF], *p;
   uint target;
   int c;
 
+  // dst is filled from buf once cons.lock is released, since a
+  // fault on a user page may sleep.
+  if(n > sizeof(buf))
+    n = sizeof(buf);
   iunlock(ip);
   target = n;
+  p = buf;
   acquire(&cons.lock);
   while(n > 0){
     while(input.r == input.w){
@@ -259,12 +265,13 @@ consoleread(struct inode *ip, char *dst, int n)
       }
       break;
     }
-    *dst++ = c;
+    *p++ = c;
     --n;
     if(c == '\n')
       break;
   }
   release(&cons.lock);
+  memmove(dst, buf, p - buf);
   ilock(ip);
 
   return target - n;
@@ -273,13 +280,20 @@ consoleread(struct inode *ip, char *dst, int n)
 int
 consolewrite(struct inode *ip, char *buf, int n)
 {
-  int i;
+  char kbuf[INPUT_BUF];
+  int i, j, m;
 
   iunlock(ip);
-  acquire(&cons.lock);
-  for(i = 0; i < n; i++)
-    consputc(buf[i] & 0xff);
-  release(&cons.lock);
+  for(i = 0; i < n; i += m){
+    m = n - i;
+    if(m > sizeof(kbuf))
+      m = sizeof(kbuf);
+    memmove(kbuf, buf + i, m);
+    acquire(&cons.lock);
+    for(j = 0; j < m; j++)
+      consputc(kbuf[j] & 0xff);
+    release(&cons.lock);
+  }
   ilock(ip);
 
   return n;
@@ -2,6 +2,7 @@ struct buf;
 struct context;
 struct file;
 struct inode;
+struct page;
 struct pipe;
 struct proc;
 struct rtcdate;
@@ -9,6 +10,9 @@ struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct swapstat;
+struct reclaimstat;
+struct procvm;
 
 // bio.c
 void            binit(void);
@@ -54,6 +58,10 @@ void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, char*, uint, uint);
 void swapread(char* ptr, int blkno);
 void swapwrite(char* ptr, int blkno);
+void swapreadv(char** pgs, int blkno, int n);
+void swapwritev(char** pgs, int blkno, int n);
+extern int      nr_sectors_read;
+extern int      nr_sectors_write;
 
 // ide.c
 void            ideinit(void);
@@ -75,6 +83,10 @@ void            insert_lru(struct page*);
 void            delete_lru(struct page*);
 void            update_lru(struct page*);
 struct page*    evict_page();
+extern int      num_free_pages;
+extern struct spinlock lru_lock;
+void            page_list_insert(struct page**, struct page*);
+void            page_list_delete(struct page**, struct page*);
 
 // kbd.c
 void            kbdintr(void);
@@ -94,6 +106,10 @@ void            log_write(struct buf*);
 void            begin_op();
 void            end_op();
 
+// lz.c
+int             lzcompress(const uchar*, int, uchar*, int);
+int             lzdecompress(const uchar*, int, uchar*, int);
+
 // mp.c
 extern int      ismp;
 void            mpinit(void);
@@ -114,6 +130,9 @@ int             cpuid(void);
 void            exit(void);
 int             fork(void);
 int             growproc(int);
+void            kthread(char*, void(*)(void));
+int             procvmstat(struct procvm*, int);
+pde_t*          setpgdir(struct proc*, pde_t*);
 int             kill(int);
 struct cpu*     mycpu(void);
 struct proc*    myproc();
@@ -128,6 +147,23 @@ int             wait(void);
 void            wakeup(void*);
 void            yield(void);
 
+// swap.c
+void            swapinit(void);
+int             reclaim(void);
+void            reclaimd(void);
+void            wakereclaimd(void);
+int             setwatermark(int, int);
+int             madvise(uint, int, int);
+int             swapin(pde_t*, char*);
+int             pagefault(pde_t*, char*, uint);
+int             cowshare(pde_t*, pde_t*, char*);
+int             page_referenced(struct page*);
+void            addupage(pde_t*, char*, char*);
+void            freeupage(pde_t*, char*);
+void            vmusage(pde_t*, uint, int*, int*);
+extern struct swapstat swapstat;
+extern struct reclaimstat reclaimstat;
+
 // swtch.S
 void            swtch(struct context**, struct context*);
 
@@ -192,6 +228,7 @@ void            switchuvm(struct proc*);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
 void            clearpteu(pde_t *pgdir, char *uva);
+uint*           walkpgdir(pde_t*, const void*, int);
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
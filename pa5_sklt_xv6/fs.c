@@ -20,6 +20,7 @@
 #include "fs.h"
 #include "buf.h"
 #include "file.h"
+#include "swap.h"
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
 static void itrunc(struct inode*);
@@ -671,41 +672,52 @@ nameiparent(char *path, char *name)
   return namex(path, 1, name);
 }
 
-void swapread(char* ptr, int blkno)
+// Move n pages between memory and the n consecutive swap slots
+// starting at blkno with a single disk command, bypassing the
+// buffer cache. pgs[i] is the kernel address of the i-th page.
+static void swaprw(char** pgs, int blkno, int n, int write)
 {
-	struct buf* bp;
-	int i;
+	struct buf b;
 
 	const int BLKS_PER_PG = PGSIZE/BSIZE;
 
-	if ( blkno < 0 || blkno >= SWAPMAX / BLKS_PER_PG )
-		panic("swapread: blkno exceeded range");
-
-	for ( i=0; i < BLKS_PER_PG; ++i ) {
-		nr_sectors_read++;
-		bp = bread(0, SWAPBASE + BLKS_PER_PG * blkno + i);
-		memmove(ptr + i * BSIZE, bp->data, BSIZE);
-		brelse(bp);
-	}
+	if ( blkno < 0 || n <= 0 || n > SWAPCLUSTER ||
+			blkno + n > SWAPMAX / BLKS_PER_PG )
+		panic("swaprw: blkno exceeded range");
+
+	memset(&b, 0, sizeof(b));
+	initsleeplock(&b.lock, "swap");
+	acquiresleep(&b.lock);
+	b.dev = 0;
+	b.blockno = SWAPBASE + BLKS_PER_PG * blkno;
+	b.pages = pgs;
+	b.nsect = BLKS_PER_PG * n;
+	if ( write ) {
+		b.flags = B_DIRTY;
+		nr_sectors_write += b.nsect;
+	} else
+		nr_sectors_read += b.nsect;
+	swapstat.nr_cmds++;
+	iderw(&b);
+	releasesleep(&b.lock);
 }
 
-void swapwrite(char* ptr, int blkno)
+void swapreadv(char** pgs, int blkno, int n)
 {
-	struct buf* bp;
-	int i;
-
-	const int BLKS_PER_PG = PGSIZE/BSIZE;
-
-	if ( blkno < 0 || blkno >= SWAPMAX / BLKS_PER_PG )
-		panic("swapwrite: blkno exceeded range");
+	swaprw(pgs, blkno, n, 0);
+}
 
-	for ( i=0; i < BLKS_PER_PG; ++i ) {
-		nr_sectors_write++;
-		bp = bread(0, SWAPBASE + BLKS_PER_PG * blkno + i);
-		memmove(bp->data, ptr + i * BSIZE, BSIZE);
-		bwrite(bp);
-		brelse(bp);
-	}
+void swapwritev(char** pgs, int blkno, int n)
+{
+	swaprw(pgs, blkno, n, 1);
 }
 
+void swapread(char* ptr, int blkno)
+{
+	swaprw(&ptr, blkno, 1, 0);
+}
 
+void swapwrite(char* ptr, int blkno)
+{
+	swaprw(&ptr, blkno, 1, 1);
+}
@@ -69,7 +69,18 @@ ideinit(void)
   outb(0x1f6, 0xe0 | (0<<4));
 }
 
+// Address of the i-th sector of a swap request.
+static void*
+swapsector(struct buf *b, int i)
+{
+  int per_page = PGSIZE/SECTOR_SIZE;
+
+  return b->pages[i / per_page] + (i % per_page) * SECTOR_SIZE;
+}
+
 // Start the request for b.  Caller must hold idelock.
+// A swap request (b->pages set) moves b->nsect sectors with one
+// command, one sector per interrupt.
 static void
 idestart(struct buf *b)
 {
@@ -79,21 +90,33 @@ idestart(struct buf *b)
     panic("incorrect blockno");
   int sector_per_block =  BSIZE/SECTOR_SIZE;
   int sector = b->blockno * sector_per_block;
+  int nsect = sector_per_block;
   int read_cmd = (sector_per_block == 1) ? IDE_CMD_READ :  IDE_CMD_RDMUL;
   int write_cmd = (sector_per_block == 1) ? IDE_CMD_WRITE : IDE_CMD_WRMUL;
 
   if (sector_per_block > 7) panic("idestart");
+  if(b->pages){
+    if(b->nsect == 0 || b->nsect > 255)
+      panic("idestart: nsect");
+    nsect = b->nsect;
+    read_cmd = IDE_CMD_READ;
+    write_cmd = IDE_CMD_WRITE;
+    b->done = 0;
+  }
 
   idewait(0);
   outb(0x3f6, 0);  // generate interrupt
-  outb(0x1f2, sector_per_block);  // number of sectors
+  outb(0x1f2, nsect);  // number of sectors
   outb(0x1f3, sector & 0xff);
   outb(0x1f4, (sector >> 8) & 0xff);
   outb(0x1f5, (sector >> 16) & 0xff);
   outb(0x1f6, 0xe0 | ((b->dev&1)<<4) | ((sector>>24)&0x0f));
   if(b->flags & B_DIRTY){
     outb(0x1f7, write_cmd);
-    outsl(0x1f0, b->data, BSIZE/4);
+    if(b->pages)
+      outsl(0x1f0, swapsector(b, 0), SECTOR_SIZE/4);
+    else
+      outsl(0x1f0, b->data, BSIZE/4);
   } else {
     outb(0x1f7, read_cmd);
   }
@@ -112,11 +135,24 @@ ideintr(void)
     release(&idelock);
     return;
   }
-  idequeue = b->qnext;
 
-  // Read data if needed.
-  if(!(b->flags & B_DIRTY) && idewait(1) >= 0)
+  if(b->pages){
+    // One sector of a swap request is done.
+    if(!(b->flags & B_DIRTY) && idewait(1) >= 0)
+      insl(0x1f0, swapsector(b, b->done), SECTOR_SIZE/4);
+    if(++b->done < b->nsect){
+      if(b->flags & B_DIRTY){
+        idewait(0);
+        outsl(0x1f0, swapsector(b, b->done), SECTOR_SIZE/4);
+      }
+      release(&idelock);
+      return;
+    }
+  } else if(!(b->flags & B_DIRTY) && idewait(1) >= 0){
+    // Read data if needed.
     insl(0x1f0, b->data, BSIZE/4);
+  }
+  idequeue = b->qnext;
 
   // Wake process waiting for this buf.
   b->flags |= B_VALID;
@@ -11,64 +11,100 @@
 
 // written by Seung Jae Oh PA4
 // LRU list for managing physical pages for swapping
+struct spinlock lru_lock;
+struct page pages[PHYSTOP / PGSIZE];
+struct page *page_lru_head;
+int num_free_pages;
+int num_lru_pages;
+
 void init_lru()
 {
+  initlock(&lru_lock, "lru");
   page_lru_head = 0;
   num_lru_pages = 0;
 }
 
-void insert_lru(struct page *p)
+// Append p at the tail of the circular list *head.
+void page_list_insert(struct page **head, struct page *p)
 {
-  struct page *head = page_lru_head;
-  if (head == 0)
+  struct page *first = *head;
+  if (first == 0)
   {
-    page_lru_head = p;
+    *head = p;
     p->next = p;
     p->prev = p;
   }
   else
   {
-    struct page *tail = head->prev;
+    struct page *tail = first->prev;
     tail->next = p;
     p->prev = tail;
-    p->next = head;
-    head->prev = p;
+    p->next = first;
+    first->prev = p;
   }
-  ++num_lru_pages;
 }
 
-void delete_lru(struct page *p)
+// Unlink p from the circular list *head.
+void page_list_delete(struct page **head, struct page *p)
 {
   struct page *prev = p->prev;
   struct page *next = p->next;
-  prev->next = next;
-  next->prev = prev;
+  if (next == p)
+    *head = 0;
+  else
+  {
+    prev->next = next;
+    next->prev = prev;
+    if (*head == p)
+      *head = next;
+  }
+  p->next = 0;
+  p->prev = 0;
+}
+
+void insert_lru(struct page *p)
+{
+  page_list_insert(&page_lru_head, p);
+  ++num_lru_pages;
+}
+
+void delete_lru(struct page *p)
+{
+  page_list_delete(&page_lru_head, p);
   --num_lru_pages;
 }
 
 void update_lru(struct page *p)
 {
-  delete_page(p);
-  insert_page(p);
+  delete_lru(p);
+  insert_lru(p);
 }
 
+// Remove and return a victim page from the LRU list, or 0 if it is empty.
+// CLOCK: the head is the hand. A page referenced since the hand last
+// passed gets its PTE_A bits cleared and a second chance. The hand
+// moves at most EVICTSCAN pages, since the caller holds lru_lock with
+// interrupts off; if none of them will do, the page under it is taken
+// anyway. A page marked PG_COLD by madvise() is taken even if
+// referenced.
+// Caller must hold lru_lock.
 struct page *evict_page()
 {
-  struct page *p = page_lru_head->next;
-  struct page *updated_head;
-  // search evictable page
-  // if PTE_A==0, evitable page
-  while (1)
+  struct page *p;
+  int n;
+
+  n = 2 * num_lru_pages;
+  if (n > EVICTSCAN)
+    n = EVICTSCAN;
+  for (; n > 0; n--)
   {
-    pte_t *pte = walkpgdir(p->pgdir, p->vaddr, 0);
-    if ((*pte & PTE_A) == 0)
-    {
+    p = page_lru_head;
+    if ((p->flags & PG_COLD) || !page_referenced(p))
       break;
-    }
-    updated_head = p;
-    p = p->next;
-    update_lru(updated_head);
+    page_lru_head = p->next;
   }
+  if ((p = page_lru_head) != 0)
+    delete_lru(p);
   return p;
 }
 
@@ -88,11 +124,6 @@ struct
   struct run *freelist;
 } kmem;
 
-struct page pages[PHYSTOP / PGSIZE];
-struct page *page_lru_head;
-int num_free_pages;
-int num_lru_pages;
-
 // Initialization happens in two phases.
 // 1. main() calls kinit1() while still using entrypgdir to place just
 // the pages mapped by entrypgdir on free list.
@@ -102,6 +133,7 @@ void kinit1(void *vstart, void *vend)
 {
   initlock(&kmem.lock, "kmem");
   kmem.use_lock = 0;
+  init_lru();
   freerange(vstart, vend);
 }
 
@@ -126,6 +158,7 @@ void freerange(void *vstart, void *vend)
 void kfree(char *v)
 {
   struct run *r;
+  struct page *page;
 
   if ((uint)v % PGSIZE || v < end || V2P(v) >= PHYSTOP)
     panic("kfree");
@@ -133,11 +166,19 @@ void kfree(char *v)
   // Fill with junk to catch dangling refs.
   memset(v, 1, PGSIZE);
 
+  page = &pages[V2P(v) / PGSIZE];
+  page->map.pgdir = 0;
+  page->map.vaddr = 0;
+  page->map.next = 0;
+  page->swapslot = -1;
+  page->flags = 0;
+
   if (kmem.use_lock)
     acquire(&kmem.lock);
   r = (struct run *)v;
   r->next = kmem.freelist;
   kmem.freelist = r;
+  num_free_pages++;
   if (kmem.use_lock)
     release(&kmem.lock);
 }
@@ -150,25 +191,22 @@ kalloc(void)
 {
   struct run *r;
 
-  // try_again:
+try_again:
   if (kmem.use_lock)
     acquire(&kmem.lock);
   r = kmem.freelist;
-  //  if(!r && reclaim())
-  //	  goto try_again;
   if (r)
-    kmem.freelist = r->next;
-  // there is not enough physical memory, swap out user memory
-  else
   {
-    
-    struct page *page = evict_page();
-    swapwrite(page->vaddr,num_free_pages);
-    pte_t *pte = walkpgdir(page->pgdir, page->vaddr, 0);
-    *pte &= ~PTE_P;
-
+    kmem.freelist = r->next;
+    num_free_pages--;
   }
   if (kmem.use_lock)
     release(&kmem.lock);
+  // there is not enough physical memory, swap out user memory
+  if (!r && kmem.use_lock && reclaim())
+    goto try_again;
+  // running low, let reclaimd evict in the background
+  if (kmem.use_lock)
+    wakereclaimd();
   return (char *)r;
 }
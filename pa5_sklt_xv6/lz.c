@@ -0,0 +1,153 @@
+// LZ77 compression in the style of LZ4, used for the compressed
+// swap pool (see swap.c).
+//
+// The output is a series of sequences. Each starts with a token
+// byte: the high nibble is the number of literals, the low nibble
+// the match length minus MINMATCH; 15 means more length bytes
+// follow (each adding up to 255, a byte < 255 ends the count).
+// After the literal length come the literals, then a 2-byte
+// little-endian offset back into the output and the match length
+// bytes. The last sequence has literals only.
+
+#include "types.h"
+#include "defs.h"
+
+#define MINMATCH  4
+#define HASHBITS  12
+
+// Last input position seen for each hash of 4 bytes. Entries left
+// over from earlier calls are harmless: every candidate is checked
+// against the input. Not reentrant; swap.c calls it holding zbuflock.
+static ushort table[1 << HASHBITS];
+
+static uint
+hash4(const uchar *p)
+{
+  uint v = p[0] | p[1] << 8 | p[2] << 16 | p[3] << 24;
+  return (v * 2654435761U) >> (32 - HASHBITS);
+}
+
+static int
+putlen(uchar *dst, int op, int cap, int len)
+{
+  for(; len >= 255; len -= 255){
+    if(op >= cap)
+      return -1;
+    dst[op++] = 255;
+  }
+  if(op >= cap)
+    return -1;
+  dst[op++] = len;
+  return op;
+}
+
+// Append a sequence of llen literals followed by a match of mlen
+// bytes at distance off; mlen == 0 ends the stream.
+static int
+putseq(uchar *dst, int op, int cap, const uchar *lit, int llen, int off, int mlen)
+{
+  int t;
+
+  if(op >= cap)
+    return -1;
+  t = op++;
+  dst[t] = (llen >= 15 ? 15 : llen) << 4;
+  if(llen >= 15 && (op = putlen(dst, op, cap, llen - 15)) < 0)
+    return -1;
+  if(op + llen > cap)
+    return -1;
+  memmove(dst + op, lit, llen);
+  op += llen;
+  if(mlen == 0)
+    return op;
+
+  if(op + 2 > cap)
+    return -1;
+  dst[op++] = off;
+  dst[op++] = off >> 8;
+  mlen -= MINMATCH;
+  dst[t] |= mlen >= 15 ? 15 : mlen;
+  if(mlen >= 15 && (op = putlen(dst, op, cap, mlen - 15)) < 0)
+    return -1;
+  return op;
+}
+
+// Compress n bytes (n < 64K) from src into dst.
+// Returns the compressed length, or -1 if it exceeds cap.
+int
+lzcompress(const uchar *src, int n, uchar *dst, int cap)
+{
+  int i, ref, anchor, op, mlen;
+  uint h;
+
+  i = anchor = op = 0;
+  while(i + MINMATCH <= n){
+    h = hash4(src + i);
+    ref = table[h];
+    table[h] = i;
+    if(ref >= i || memcmp(src + ref, src + i, MINMATCH) != 0){
+      i++;
+      continue;
+    }
+    for(mlen = MINMATCH; i + mlen < n && src[ref + mlen] == src[i + mlen]; mlen++)
+      ;
+    op = putseq(dst, op, cap, src + anchor, i - anchor, i - ref, mlen);
+    if(op < 0)
+      return -1;
+    i += mlen;
+    anchor = i;
+  }
+  return putseq(dst, op, cap, src + anchor, n - anchor, 0, 0);
+}
+
+static int
+getlen(const uchar *src, int *ip, int len, int n)
+{
+  int b;
+
+  do {
+    if(*ip >= len)
+      return -1;
+    b = src[(*ip)++];
+    n += b;
+  } while(b == 255);
+  return n;
+}
+
+// Decompress len bytes from src into dst, which holds n bytes.
+// Returns the decompressed length, or -1 if src is corrupt.
+int
+lzdecompress(const uchar *src, int len, uchar *dst, int n)
+{
+  int ip, op, t, llen, mlen, off;
+
+  ip = op = 0;
+  while(ip < len){
+    t = src[ip++];
+    llen = t >> 4;
+    if(llen == 15 && (llen = getlen(src, &ip, len, llen)) < 0)
+      return -1;
+    if(ip + llen > len || op + llen > n)
+      return -1;
+    memmove(dst + op, src + ip, llen);
+    ip += llen;
+    op += llen;
+    if(ip >= len)
+      break;
+
+    if(ip + 2 > len)
+      return -1;
+    off = src[ip] | src[ip+1] << 8;
+    ip += 2;
+    mlen = t & 15;
+    if(mlen == 15 && (mlen = getlen(src, &ip, len, mlen)) < 0)
+      return -1;
+    mlen += MINMATCH;
+    if(off == 0 || off > op || op + mlen > n)
+      return -1;
+    // Byte at a time: the match may overlap its own output.
+    for(; mlen > 0; mlen--, op++)
+      dst[op] = dst[op - off];
+  }
+  return op;
+}
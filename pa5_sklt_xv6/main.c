@@ -33,7 +33,9 @@ main(void)
   ideinit();       // disk 
   startothers();   // start other processors
   kinit2(P2V(4*1024*1024), P2V(PHYSTOP)); // must come after startothers()
+  swapinit();      // compressed swap pool
   userinit();      // first user process
+  kthread("reclaimd", reclaimd); // background page reclaim
   mpmain();        // finish this processor's setup
 }
 
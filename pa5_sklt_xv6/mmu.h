@@ -96,6 +96,13 @@ struct segdesc {
 #define PTE_U           0x004   // User
 #define PTE_PS          0x080   // Page Size
 #define PTE_A           0x20   // Accessed
+#define PTE_D           0x40   // Dirty
+#define PTE_COW         0x800  // Writeable once copied (software bit)
+
+// Page fault error code bits
+#define FEC_PR          0x1    // Protection violation, page was present
+#define FEC_WR          0x2    // Caused by a write
+#define FEC_U           0x4    // Caused in user mode
 
 // Address in page table or page directory entry
 #define PTE_ADDR(pte)   ((uint)(pte) & ~0xFFF)
@@ -179,13 +186,27 @@ struct gatedesc {
   (gate).off_31_16 = (uint)(off) >> 16;                  \
 }
 
+// A user mapping of a physical page.
+struct rmap{
+	pde_t *pgdir;
+	char *vaddr;
+	struct rmap *next;
+};
+
 struct page{
 	struct page *next;
 	struct page *prev;
-	pde_t *pgdir;
-	char *vaddr;
+	struct rmap map;	// first mapping; more after fork on map.next
+	int swapslot;	// swap slot holding an identical copy, or -1
+	int flags;
 };
 
+// struct page flags
+#define PG_LRU          0x1    // mapped, on the LRU list
+#define PG_CACHED       0x2    // unmapped, on the swap cache list
+#define PG_WRITEBACK    0x4    // being written to its swap slot
+#define PG_COLD         0x8    // evict before referenced pages (madvise)
+
 
 
 #endif
@@ -13,4 +13,10 @@
 #define FSSIZE       100000  // size of file system in blocks
 #define SWAPBASE	500
 #define SWAPMAX		(100000 - SWAPBASE)
+#define SWAPCLUSTER   8  // max pages moved by one swap disk command
+#define LOWWMARK     64  // free pages below which reclaimd wakes up
+#define HIGHWMARK   256  // free pages reclaimd evicts up to
+#define ZPOOLPAGES  512  // pages of memory for compressed swap
+#define EVICTSCAN    64  // most LRU pages evict_page() looks at per call
+#define NMADV         4  // madvise() ranges remembered per process
 
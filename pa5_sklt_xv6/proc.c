@@ -6,6 +6,7 @@
 #include "x86.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "swap.h"
 
 struct {
   struct spinlock lock;
@@ -88,6 +89,11 @@ allocproc(void)
 found:
   p->state = EMBRYO;
   p->pid = nextpid++;
+  p->minflt = 0;
+  p->majflt = 0;
+  p->reclaimk = 0;
+  memset(p->madv, 0, sizeof(p->madv));
+  p->nextmadv = 0;
 
   release(&ptable.lock);
 
@@ -153,6 +159,71 @@ userinit(void)
   release(&ptable.lock);
 }
 
+// Start a kernel thread that runs fn, which must never return.
+// The thread has only the kernel part of an address space and
+// never enters user space.
+void
+kthread(char *name, void (*fn)(void))
+{
+  struct proc *p;
+
+  if((p = allocproc()) == 0)
+    panic("kthread: no proc");
+  if((p->pgdir = setupkvm()) == 0)
+    panic("kthread: out of memory?");
+  // forkret returns into fn instead of trapret.
+  *(uint*)(p->context + 1) = (uint)fn;
+  safestrcpy(p->name, name, sizeof(p->name));
+
+  acquire(&ptable.lock);
+  p->state = RUNNABLE;
+  release(&ptable.lock);
+}
+
+// Fill st with the memory statistics of up to n processes.
+// Returns how many were filled in.
+int
+procvmstat(struct procvm *st, int n)
+{
+  struct proc *p;
+  int i;
+
+  // ptable.lock is taken once per process, so interrupts stay off
+  // for one page table walk at a time. It keeps wait() and exec()
+  // from freeing the page table being walked.
+  i = 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC] && i < n; p++){
+    acquire(&ptable.lock);
+    if(p->state == UNUSED || p->state == EMBRYO){
+      release(&ptable.lock);
+      continue;
+    }
+    st[i].pid = p->pid;
+    safestrcpy(st[i].name, p->name, sizeof(st[i].name));
+    st[i].minflt = p->minflt;
+    st[i].majflt = p->majflt;
+    st[i].kcycles = p->reclaimk;
+    vmusage(p->pgdir, p->sz, &st[i].rss, &st[i].swap);
+    release(&ptable.lock);
+    i++;
+  }
+  return i;
+}
+
+// Make pgdir p's page table and return the old one, which the
+// caller frees. Done under ptable.lock for procvmstat().
+pde_t*
+setpgdir(struct proc *p, pde_t *pgdir)
+{
+  pde_t *old;
+
+  acquire(&ptable.lock);
+  old = p->pgdir;
+  p->pgdir = pgdir;
+  release(&ptable.lock);
+  return old;
+}
+
 // Grow current process's memory by n bytes.
 // Return 0 on success, -1 on failure.
 int
@@ -197,6 +268,8 @@ fork(void)
     return -1;
   }
   np->sz = curproc->sz;
+  memmove(np->madv, curproc->madv, sizeof(curproc->madv));
+  np->nextmadv = curproc->nextmadv;
   np->parent = curproc;
   *np->tf = *curproc->tf;
 
@@ -274,6 +347,7 @@ wait(void)
 {
   struct proc *p;
   int havekids, pid;
+  pde_t *pgdir;
   struct proc *curproc = myproc();
   
   acquire(&ptable.lock);
@@ -289,13 +363,17 @@ wait(void)
         pid = p->pid;
         kfree(p->kstack);
         p->kstack = 0;
-        freevm(p->pgdir);
+        pgdir = p->pgdir;
+        p->pgdir = 0;
         p->pid = 0;
         p->parent = 0;
         p->name[0] = 0;
         p->killed = 0;
         p->state = UNUSED;
         release(&ptable.lock);
+        // freevm() takes lru_lock, which swap.c holds around wakeup()
+        // and sleep(), so it must not nest inside ptable.lock.
+        freevm(pgdir);
         return pid;
       }
     }
@@ -34,6 +34,13 @@ struct context {
 
 enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
+// A range of the address space given advice by madvise().
+struct madvice {
+  uint start;
+  uint end;
+  int advice;
+};
+
 // Per-process state
 struct proc {
   uint sz;                     // Size of process memory (bytes)
@@ -49,6 +56,11 @@ struct proc {
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
+  int minflt;                  // Page faults served from memory
+  int majflt;                  // Page faults that read swap
+  uint reclaimk;               // Kilocycles spent reclaiming memory
+  struct madvice madv[NMADV];  // madvise() ranges, oldest replaced first
+  int nextmadv;                // Slot in madv for the next range
 };
 
 // Process memory is laid out contiguously, low addresses first:
@@ -0,0 +1,1222 @@
+// Swapping of user pages.
+//
+// Every mapped user page is on the LRU list in kalloc.c. When kalloc()
+// runs out of memory it calls reclaim(), which evicts a victim chosen
+// by evict_page(): the page is written to a free slot of the swap area
+// (see swapwrite in fs.c) and every PTE mapping it is replaced by the
+// slot number with PTE_P cleared. A later access faults, and swapin()
+// brings the page back.
+//
+// fork() shares pages copy-on-write instead of copying them, so a
+// page may be mapped by several processes. The mappings of a page are
+// kept in its reverse map (struct rmap), which lets the replacer test
+// and clear PTE_A in all of them and lets eviction unmap them all.
+// A swap slot counts its references: one per PTE naming it, plus one
+// if a page holds a copy of it. A mapping is writable only while it is
+// the page's sole reference; otherwise it is marked PTE_COW and the
+// first write copies the page (cowbreak).
+//
+// The swap cache remembers which physical page holds an identical
+// copy of a swap slot. A page keeps its slot after it is swapped in,
+// so if it is evicted again before it has been written to (PTE_D
+// clear) it is dropped without touching the disk. An evicted page
+// also stays in memory on the swap cache list until kalloc() needs
+// it, and a fault on it in the meantime simply maps it back.
+//
+// To keep evictions out of kalloc()'s path, the reclaimd kernel
+// thread wakes when free pages (counting cached ones, which are
+// freed without I/O) drop below reclaimstat.low and swaps pages out
+// into the cache until there are reclaimstat.high of them.
+//
+// Evictions are clustered: swapout() takes up to SWAPCLUSTER victims
+// and writes the dirty ones to consecutive slots with one disk
+// command. On a major fault, neighbouring virtual pages that went
+// out in the same cluster are read back with the faulting page and
+// left in the swap cache.
+//
+// madvise() tunes both per range of a process. RANDOM turns read
+// around off; SEQUENTIAL reads ahead only and marks the pages it
+// brings in PG_COLD, so evict_page() takes them before referenced
+// pages and a streaming process pushes out what it already passed
+// rather than other processes' working sets.
+//
+// Before going to disk, a dirty victim is compressed (lz.c) into a
+// pool of ZPOOLPAGES pages set aside at boot. The page gets a swap
+// slot as usual, but the slot's data lives in the pool and a fault
+// on it is served by decompressing, with no disk I/O. Only pages
+// that do not compress to ZMAXLEN bytes, or that no longer fit in
+// the pool, are written to the swap area. A page loaded from the
+// pool gives up its pool space and slot unless another process
+// still needs them, since pool space is scarce. Compression runs
+// without lru_lock, on victims that are already unmapped and marked
+// PG_WRITEBACK as for a disk write.
+//
+// There is no cross-CPU TLB shootdown. A process's user mappings are
+// only cached by the CPU running it, and scheduler() flushes them on
+// every switch, so PTEs of a process that is not running elsewhere
+// can be changed with a local invlpg. Eviction gives up on a page
+// mapped by a process running on another CPU.
+//
+// lru_lock protects the LRU list, the reverse maps, the swap cache,
+// the slot counts, the compressed pool and the swapped-out PTEs of
+// every process.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "swap.h"
+
+#define NSWAPSLOT (SWAPMAX / (PGSIZE / BSIZE))
+#define ZCHUNK    64                // pool allocation unit in bytes
+#define ZCHUNKS   (PGSIZE / ZCHUNK) // chunks per pool page
+#define ZMAXLEN   (PGSIZE * 3 / 4)  // compress at least this well to be pooled
+
+extern struct page pages[];
+extern struct page *page_lru_head;
+
+struct {
+  ushort ref[NSWAPSLOT];    // references to each slot, 0 if free
+  uint cache[NSWAPSLOT];    // physical address holding the slot, or 0
+  struct page *cached;      // evicted pages still in memory, oldest first
+} swap;
+
+// Where a slot's data is in the pool; len is 0 if it is on disk.
+struct zent {
+  ushort len;
+  ushort page;
+  uchar chunk;
+  uchar nchunk;
+};
+
+struct {
+  char *page[ZPOOLPAGES];
+  uint used[ZPOOLPAGES][ZCHUNKS / 32]; // chunk bitmap per page
+  uchar nfree[ZPOOLPAGES];             // free chunks per page
+  int npages;
+  struct zent slot[NSWAPSLOT];
+} zpool;
+
+static uchar zbuf[ZMAXLEN];            // compression output
+static struct sleeplock zbuflock;      // protects zbuf
+
+// Free entries for mappings beyond the first one of each page,
+// carved from whole pages by rmapgrow().
+struct {
+  struct rmap *free;
+} rmaps;
+
+struct swapstat swapstat;
+struct reclaimstat reclaimstat = { .low = LOWWMARK, .high = HIGHWMARK };
+static int reclaimd_running;
+static uint reclaimd_failtick;  // tick of reclaimd's last fruitless pass
+
+static struct page*
+pa2page(uint pa)
+{
+  return &pages[pa / PGSIZE];
+}
+
+static uint
+page2pa(struct page *p)
+{
+  return (p - pages) * PGSIZE;
+}
+
+// Record that pgdir maps p at va.
+// Returns -1 if p is mapped already and no rmap entry is free.
+static int
+rmapadd(struct page *p, pde_t *pgdir, char *va)
+{
+  struct rmap *r;
+
+  if(p->map.pgdir == 0){
+    p->map.pgdir = pgdir;
+    p->map.vaddr = va;
+    p->map.next = 0;
+    return 0;
+  }
+  if((r = rmaps.free) == 0)
+    return -1;
+  rmaps.free = r->next;
+  r->pgdir = pgdir;
+  r->vaddr = va;
+  r->next = p->map.next;
+  p->map.next = r;
+  return 0;
+}
+
+// Add a page of free rmap entries if there are none. Called
+// without lru_lock, which kalloc may need.
+static void
+rmapgrow(void)
+{
+  struct rmap *r;
+  char *mem;
+
+  // Unlocked peek: a wrong guess costs a page or a copy.
+  if(rmaps.free != 0 || (mem = kalloc()) == 0)
+    return;
+  acquire(&lru_lock);
+  for(r = (struct rmap*)mem; (char*)(r + 1) <= mem + PGSIZE; r++){
+    r->next = rmaps.free;
+    rmaps.free = r;
+  }
+  release(&lru_lock);
+}
+
+static void
+rmapdel(struct page *p, pde_t *pgdir, char *va)
+{
+  struct rmap *r, **rp;
+
+  if(p->map.pgdir == pgdir && p->map.vaddr == va){
+    if((r = p->map.next) == 0){
+      p->map.pgdir = 0;
+      p->map.vaddr = 0;
+      return;
+    }
+    p->map = *r;
+  } else {
+    for(rp = &p->map.next; (r = *rp) != 0; rp = &r->next)
+      if(r->pgdir == pgdir && r->vaddr == va)
+        break;
+    if(r == 0)
+      panic("rmapdel");
+    *rp = r->next;
+  }
+  r->next = rmaps.free;
+  rmaps.free = r;
+}
+
+static int
+nmapped(struct page *p)
+{
+  struct rmap *r;
+  int n;
+
+  if(p->map.pgdir == 0)
+    return 0;
+  n = 0;
+  for(r = &p->map; r; r = r->next)
+    n++;
+  return n;
+}
+
+// Is p referenced from nowhere but a single mapping?
+static int
+exclusive(struct page *p)
+{
+  return nmapped(p) == 1 &&
+         (p->swapslot < 0 || swap.ref[p->swapslot] == 1);
+}
+
+// Flags for mapping p: writable only if the mapping is exclusive,
+// copy-on-write if it would be writable but is shared.
+static uint
+cowflags(struct page *p, uint flags)
+{
+  if((flags & (PTE_W | PTE_COW)) == 0)
+    return flags;
+  flags &= ~(PTE_W | PTE_COW);
+  return flags | (exclusive(p) ? PTE_W : PTE_COW);
+}
+
+// Is pgdir loaded on a CPU other than this one?
+static int
+liveelsewhere(pde_t *pgdir)
+{
+  struct cpu *c;
+  struct proc *p;
+
+  for(c = cpus; c < cpus + ncpu; c++){
+    if(c == mycpu())
+      continue;
+    if((p = c->proc) != 0 && p->pgdir == pgdir)
+      return 1;
+  }
+  return 0;
+}
+
+// Invalidate the TLB entry for va if pgdir is loaded on this CPU.
+static void
+flushpte(pde_t *pgdir, char *va)
+{
+  struct proc *curproc = myproc();
+
+  if(curproc && curproc->pgdir == pgdir)
+    invlpg(va);
+}
+
+// Test and clear PTE_A in every mapping of p. A mapping live on
+// another CPU can't be flushed there and counts as referenced.
+int
+page_referenced(struct page *p)
+{
+  struct rmap *r;
+  pte_t *pte;
+  int ref;
+
+  reclaimstat.scanned++;
+  ref = 0;
+  for(r = &p->map; r && r->pgdir; r = r->next){
+    if(liveelsewhere(r->pgdir)){
+      ref = 1;
+      continue;
+    }
+    pte = walkpgdir(r->pgdir, r->vaddr, 0);
+    if(*pte & PTE_A){
+      __sync_fetch_and_and(pte, ~PTE_A);
+      flushpte(r->pgdir, r->vaddr);
+      ref = 1;
+    }
+  }
+  return ref;
+}
+
+// Has p been written since it was last copied to its slot?
+static int
+pagedirty(struct page *p)
+{
+  struct rmap *r;
+
+  if(p->swapslot < 0)
+    return 1;
+  for(r = &p->map; r && r->pgdir; r = r->next)
+    if(*walkpgdir(r->pgdir, r->vaddr, 0) & PTE_D)
+      return 1;
+  return 0;
+}
+
+// Mark nchunk chunks from chunk in pool page pg used or free.
+static void
+zmark(int pg, int chunk, int nchunk, int used)
+{
+  int c;
+
+  for(c = chunk; c < chunk + nchunk; c++){
+    if(used)
+      zpool.used[pg][c/32] |= 1 << (c%32);
+    else
+      zpool.used[pg][c/32] &= ~(1 << (c%32));
+  }
+  zpool.nfree[pg] += used ? -nchunk : nchunk;
+}
+
+// Copy len compressed bytes from zbuf into the pool as the data of
+// slot. Returns -1 if no pool page has room.
+static int
+zalloc(int slot, int len)
+{
+  struct zent *e;
+  int pg, c, run, n;
+
+  n = (len + ZCHUNK - 1) / ZCHUNK;
+  for(pg = 0; pg < zpool.npages; pg++){
+    if(zpool.nfree[pg] < n)
+      continue;
+    run = 0;
+    for(c = 0; c < ZCHUNKS; c++){
+      if(zpool.used[pg][c/32] & (1 << (c%32)))
+        run = 0;
+      else if(++run == n)
+        break;
+    }
+    if(run < n)
+      continue;
+    c = c - n + 1;
+    zmark(pg, c, n, 1);
+    memmove(zpool.page[pg] + c*ZCHUNK, zbuf, len);
+    e = &zpool.slot[slot];
+    e->len = len;
+    e->page = pg;
+    e->chunk = c;
+    e->nchunk = n;
+    swapstat.zstored++;
+    swapstat.zbytes += len;
+    return 0;
+  }
+  return -1;
+}
+
+static void
+zfree(int slot)
+{
+  struct zent *e = &zpool.slot[slot];
+
+  if(e->len == 0)
+    return;
+  zmark(e->page, e->chunk, e->nchunk, 0);
+  swapstat.zstored--;
+  swapstat.zbytes -= e->len;
+  e->len = 0;
+}
+
+// Allocate n consecutive swap slots with one reference each;
+// return the first or -1.
+static int
+swapalloc(int n)
+{
+  int i, run;
+
+  run = 0;
+  for(i = 0; i < NSWAPSLOT; i++){
+    if(swap.ref[i]){
+      run = 0;
+      continue;
+    }
+    if(++run == n)
+      break;
+  }
+  if(run < n)
+    return -1;
+  for(i = i - n + 1; run > 0; run--, i++){
+    swap.ref[i] = 1;
+    swapstat.nr_slots++;
+  }
+  return i - n;
+}
+
+// Drop a reference to slot, freeing it with the last one.
+static void
+swapfree(int slot)
+{
+  if(swap.ref[slot] == 0)
+    panic("swapfree");
+  if(--swap.ref[slot] > 0)
+    return;
+  zfree(slot);
+  swap.cache[slot] = 0;
+  swapstat.nr_slots--;
+}
+
+// Make p hold a copy of slot.
+static void
+holdslot(struct page *p, int slot)
+{
+  p->swapslot = slot;
+  swap.cache[slot] = page2pa(p);
+  swap.ref[slot]++;
+}
+
+// Make p forget its slot, e.g. because it no longer matches.
+static void
+dropslot(struct page *p)
+{
+  if(p->swapslot < 0)
+    return;
+  swap.cache[p->swapslot] = 0;
+  swapfree(p->swapslot);
+  p->swapslot = -1;
+}
+
+// Free p, which has no mappings left.
+static void
+freepage(struct page *p)
+{
+  dropslot(p);
+  kfree(P2V(page2pa(p)));
+}
+
+static void
+addcached(struct page *p)
+{
+  p->flags = PG_CACHED;
+  page_list_insert(&swap.cached, p);
+  swapstat.nr_cached++;
+}
+
+static void
+delcached(struct page *p)
+{
+  page_list_delete(&swap.cached, p);
+  swapstat.nr_cached--;
+}
+
+// p lost its last mapping: keep it in the swap cache while
+// swapped-out PTEs still name its slot, else free it.
+static void
+unmapped(struct page *p)
+{
+  delete_lru(p);
+  if(p->swapslot >= 0 && swap.ref[p->swapslot] > 1)
+    addcached(p);
+  else
+    freepage(p);
+}
+
+// Put the mappings of p back after a failed unmapall(). dirty says
+// whether p must still be treated as written.
+static void
+remap(struct page *p, int dirty)
+{
+  struct rmap *r;
+  pte_t *pte;
+
+  for(r = &p->map; r; r = r->next){
+    pte = walkpgdir(r->pgdir, r->vaddr, 0);
+    *pte = page2pa(p) | PTE_FLAGS(*pte) | PTE_P | PTE_A | (dirty ? PTE_D : 0);
+  }
+}
+
+// Replace every mapping of p by slot. Fails, leaving p mapped, if
+// an address space mapping p is live on another CPU, or if p was
+// written although the caller took it for clean. On success the
+// rmap is kept until unmapdone(), so remap() can still undo it.
+static int
+unmapall(struct page *p, int slot, int dirty)
+{
+  struct rmap *r;
+  pte_t *pte;
+  uint old;
+  int written;
+
+  written = 0;
+  for(r = &p->map; r; r = r->next){
+    pte = walkpgdir(r->pgdir, r->vaddr, 0);
+    // xchg so a PTE_D set meanwhile by another CPU isn't lost.
+    old = xchg(pte, (slot << PTXSHIFT) | (PTE_FLAGS(*pte) & ~(PTE_P | PTE_A | PTE_D)));
+    written |= old & PTE_D;
+    flushpte(r->pgdir, r->vaddr);
+  }
+  // A CPU that loads one of these page tables from now on sees the
+  // new PTEs; one that had it loaded already shows up here.
+  __sync_synchronize();
+  for(r = &p->map; r; r = r->next){
+    if(liveelsewhere(r->pgdir) || (written && !dirty)){
+      remap(p, dirty || written);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Finish unmapall(): the PTEs now reference slot.
+static void
+unmapdone(struct page *p, int slot)
+{
+  while(p->map.pgdir){
+    swap.ref[slot]++;
+    rmapdel(p, p->map.pgdir, p->map.vaddr);
+  }
+}
+
+// Compress the unmapped pages wb[0..n-1], whose slots start at
+// first, into the pool. A page that fits has its mem[] entry
+// cleared, so it is not written to disk. Called without lru_lock,
+// which is taken only to place each result.
+static void
+zstore(struct page **wb, char **mem, int first, int n)
+{
+  int i, len;
+
+  if(zpool.npages == 0)
+    return;
+  acquiresleep(&zbuflock);
+  for(i = 0; i < n; i++){
+    if(wb[i] == 0)
+      continue;
+    len = lzcompress((uchar*)mem[i], PGSIZE, zbuf, ZMAXLEN);
+    acquire(&lru_lock);
+    if(len >= 0 && zalloc(first + i, len) == 0)
+      mem[i] = 0;
+    else
+      swapstat.zrejects++;
+    release(&lru_lock);
+  }
+  releasesleep(&zbuflock);
+}
+
+// Decompress slot's data from the pool into mem.
+static void
+zload(int slot, char *mem)
+{
+  struct zent *e = &zpool.slot[slot];
+  uchar *src = (uchar*)zpool.page[e->page] + e->chunk*ZCHUNK;
+
+  if(lzdecompress(src, e->len, (uchar*)mem, PGSIZE) != PGSIZE)
+    panic("zload");
+}
+
+// Set aside the compressed pool.
+void
+swapinit(void)
+{
+  int i;
+
+  initsleeplock(&zbuflock, "zbuf");
+  for(i = 0; i < ZPOOLPAGES; i++){
+    if((zpool.page[i] = kalloc()) == 0)
+      break;
+    zpool.nfree[i] = ZCHUNKS;
+  }
+  zpool.npages = i;
+  swapstat.zpool_pages = i;
+}
+
+// Evict up to SWAPCLUSTER pages from the LRU list into the swap
+// cache. Victims with a clean copy in swap are just unmapped. Dirty
+// ones are unmapped into consecutive slots, compressed into the pool
+// if they fit, and the rest are written with one disk command per
+// run of slots.
+// Returns the number of pages evicted, 0 if there was nothing to
+// evict or swap is full.
+static int
+swapout(void)
+{
+  struct page *p, *wb[SWAPCLUSTER];
+  char *mem[SWAPCLUSTER];
+  int i, j, n, nwb, first;
+
+  acquire(&lru_lock);
+  n = nwb = 0;
+  while(n + nwb < SWAPCLUSTER && (p = evict_page()) != 0){
+    if(pagedirty(p)){
+      wb[nwb++] = p;
+      continue;
+    }
+    if(unmapall(p, p->swapslot, 0) < 0){
+      // In use on another CPU; try again later.
+      insert_lru(p);
+      break;
+    }
+    unmapdone(p, p->swapslot);
+    addcached(p);
+    swapstat.writes_saved++;
+    n++;
+  }
+  if(nwb > 0){
+    // Stale copies are dropped so the whole cluster can be contiguous.
+    for(i = 0; i < nwb; i++)
+      dropslot(wb[i]);
+    if((first = swapalloc(nwb)) < 0){
+      for(i = 0; i < nwb; i++)
+        insert_lru(wb[i]);
+      nwb = 0;
+    }
+    for(i = 0; i < nwb; i++){
+      p = wb[i];
+      mem[i] = P2V(page2pa(p));
+      p->swapslot = first + i;
+      swap.cache[first + i] = page2pa(p);
+      if(unmapall(p, first + i, 1) < 0){
+        // Leave a hole: the slot stays allocated until the rest
+        // of the cluster is done.
+        p->swapslot = -1;
+        swap.cache[first + i] = 0;
+        insert_lru(p);
+        wb[i] = 0;
+        mem[i] = 0;
+        continue;
+      }
+      unmapdone(p, first + i);
+      p->flags = PG_WRITEBACK;
+      n++;
+    }
+  }
+  swapstat.swapouts += n;
+  release(&lru_lock);
+  if(nwb == 0)
+    return n;
+
+  zstore(wb, mem, first, nwb);
+  for(i = 0; i < nwb; i = j){
+    for(; i < nwb && mem[i] == 0; i++)
+      ;
+    for(j = i; j < nwb && mem[j] != 0; j++)
+      ;
+    if(j > i)
+      swapwritev(mem + i, first + i, j - i);
+  }
+
+  acquire(&lru_lock);
+  for(i = 0; i < nwb; i++){
+    if((p = wb[i]) == 0){
+      swapfree(first + i);
+      continue;
+    }
+    wakeup(p);
+    if(swap.ref[p->swapslot] == 1){
+      // Every PTE went away during the write.
+      freepage(p);
+    } else
+      addcached(p);
+  }
+  release(&lru_lock);
+  return n;
+}
+
+// Charge the reclaim work started at TSC value t0 to the system
+// and to the process it ran in.
+static void
+reclaimtime(uint t0)
+{
+  struct proc *p = myproc();
+  uint k = (rdtsc() - t0) >> 10;
+
+  reclaimstat.kcycles += k;
+  if(p)
+    p->reclaimk += k;
+}
+
+// Free one page of memory: drop the oldest page of the swap cache,
+// evicting an LRU page into the cache first if it is empty.
+// Returns 1 if a page was freed, 0 if nothing could be reclaimed.
+int
+reclaim(void)
+{
+  struct page *p;
+  uint t0;
+  int n;
+
+  t0 = rdtsc();
+  acquire(&lru_lock);
+  reclaimstat.direct++;
+  n = 1;
+  while(swap.cached == 0){
+    release(&lru_lock);
+    n = swapout();
+    acquire(&lru_lock);
+    if(n == 0)
+      break;
+    reclaimstat.direct_swapouts++;
+  }
+  if(n > 0){
+    p = swap.cached;
+    delcached(p);
+    freepage(p);
+  }
+  reclaimtime(t0);
+  release(&lru_lock);
+  return n > 0;
+}
+
+static int
+freepages(void)
+{
+  return num_free_pages + swapstat.nr_cached;
+}
+
+// Called by kalloc(). Unlocked reads are fine: a missed wakeup
+// is repeated by the next allocation. After a pass that found
+// nothing to evict, reclaimd is left alone for the rest of that
+// tick rather than woken by every allocation.
+void
+wakereclaimd(void)
+{
+  if(!reclaimd_running && freepages() < reclaimstat.low &&
+     ticks != reclaimd_failtick)
+    wakeup(&reclaimstat);
+}
+
+// Body of the reclaimd kernel thread.
+void
+reclaimd(void)
+{
+  uint t0;
+  int n;
+
+  acquire(&lru_lock);
+  for(;;){
+    reclaimd_running = 0;
+    sleep(&reclaimstat, &lru_lock);
+    reclaimd_running = 1;
+    reclaimstat.wakeups++;
+    t0 = rdtsc();
+    while(freepages() < reclaimstat.high){
+      release(&lru_lock);
+      n = swapout();
+      acquire(&lru_lock);
+      if(n == 0){
+        reclaimd_failtick = ticks;
+        break;
+      }
+      reclaimstat.reclaimed += n;
+    }
+    reclaimtime(t0);
+  }
+}
+
+// Set the watermarks; a negative value leaves one unchanged.
+int
+setwatermark(int low, int high)
+{
+  acquire(&lru_lock);
+  if(low < 0)
+    low = reclaimstat.low;
+  if(high < 0)
+    high = reclaimstat.high;
+  if(low > high){
+    release(&lru_lock);
+    return -1;
+  }
+  reclaimstat.low = low;
+  reclaimstat.high = high;
+  release(&lru_lock);
+  wakereclaimd();
+  return 0;
+}
+
+// Return slot if va in pgdir is swapped out to it with no copy
+// in memory, else -1.
+static int
+uncachedslot(pde_t *pgdir, uint va, int slot)
+{
+  pte_t *pte;
+
+  if(va >= KERNBASE || slot < 0 || slot >= NSWAPSLOT)
+    return -1;
+  pte = walkpgdir(pgdir, (char*)va, 0);
+  if(pte == 0 || (*pte & PTE_P) || *pte == 0)
+    return -1;
+  if(PTE_ADDR(*pte) >> PTXSHIFT != slot || swap.cache[slot] != 0 ||
+     zpool.slot[slot].len != 0)
+    return -1;
+  return slot;
+}
+
+// Put mem, a fresh page, on the LRU list without a slot.
+static struct page*
+newpage(char *mem)
+{
+  struct page *p = pa2page(V2P(mem));
+
+  p->swapslot = -1;
+  p->flags = PG_LRU;
+  insert_lru(p);
+  return p;
+}
+
+// Return the advice of the current process's newest madvise()
+// range holding va, if pgdir is its page table.
+static int
+advice(pde_t *pgdir, uint va)
+{
+  struct proc *curproc = myproc();
+  struct madvice *m;
+  int i;
+
+  if(curproc == 0 || curproc->pgdir != pgdir)
+    return MADV_NORMAL;
+  for(i = 1; i <= NMADV; i++){
+    m = &curproc->madv[(curproc->nextmadv + NMADV - i) % NMADV];
+    if(va >= m->start && va < m->end)
+      return m->advice;
+  }
+  return MADV_NORMAL;
+}
+
+// Bring the page at va back from swap. A copy still in the swap
+// cache is mapped again directly and a pooled one is decompressed;
+// otherwise the slot is read, together with the neighbouring pages
+// that were swapped out to the slots around it, which go into the
+// swap cache. How far to read around follows madvise().
+// Returns 0 if the page is present afterwards, -1 if va is not
+// a swapped-out user page or memory is exhausted.
+int
+swapin(pde_t *pgdir, char *va)
+{
+  struct proc *curproc = myproc();
+  struct page *p;
+  pte_t *pte;
+  char *mem[SWAPCLUSTER];
+  uint pa, start, old;
+  int i, n, slot, first, fault, adv;
+
+  va = (char*)PGROUNDDOWN((uint)va);
+  adv = advice(pgdir, (uint)va);
+  acquire(&lru_lock);
+retry:
+  pte = walkpgdir(pgdir, va, 0);
+  if(pte == 0 || *pte == 0){
+    release(&lru_lock);
+    return -1;
+  }
+  if(*pte & PTE_P){
+    release(&lru_lock);
+    return 0;
+  }
+  slot = PTE_ADDR(*pte) >> PTXSHIFT;
+  if((pa = swap.cache[slot]) != 0){
+    p = pa2page(pa);
+    if(p->flags & PG_WRITEBACK){
+      // The page may be reclaimed once written; look again.
+      sleep(p, &lru_lock);
+      goto retry;
+    }
+    if(p->flags & PG_CACHED){
+      delcached(p);
+      p->flags = PG_LRU;
+      insert_lru(p);
+    } else if(rmaps.free == 0){
+      // Mapped elsewhere, but no rmap entry to share it: copy.
+      old = *pte;
+      release(&lru_lock);
+      if((mem[0] = kalloc()) == 0)
+        return -1;
+      acquire(&lru_lock);
+      if(*pte != old || swap.cache[slot] != pa){
+        kfree(mem[0]);
+        goto retry;
+      }
+      memmove(mem[0], P2V(pa), PGSIZE);
+      p = newpage(mem[0]);
+    }
+    swapstat.minor_faults++;
+    if(curproc)
+      curproc->minflt++;
+  } else if(zpool.slot[slot].len != 0){
+    old = *pte;
+    release(&lru_lock);
+    if((mem[0] = kalloc()) == 0)
+      return -1;
+    acquire(&lru_lock);
+    if(*pte != old){
+      kfree(mem[0]);
+      goto retry;
+    }
+    zload(slot, mem[0]);
+    p = newpage(mem[0]);
+    // Keep the pool copy only for the other PTEs naming it.
+    if(swap.ref[slot] > 1)
+      holdslot(p, slot);
+    swapstat.zhits++;
+    if(curproc)
+      curproc->majflt++;
+  } else {
+    // Read around: extend [start, start+n) over neighbours whose
+    // slots continue the run on either side.
+    start = (uint)va;
+    first = slot;
+    n = 1;
+    while(adv == MADV_NORMAL && n < SWAPCLUSTER/2 &&
+          uncachedslot(pgdir, start - PGSIZE, first - 1) >= 0){
+      start -= PGSIZE;
+      first--;
+      n++;
+    }
+    while(adv != MADV_RANDOM && n < SWAPCLUSTER &&
+          uncachedslot(pgdir, start + n*PGSIZE, first + n) >= 0)
+      n++;
+    fault = slot - first;
+    release(&lru_lock);
+
+    if((mem[fault] = kalloc()) == 0)
+      return -1;
+    for(i = 0; i < n; i++){
+      if(i != fault && (mem[i] = kalloc()) == 0)
+        break;
+    }
+    if(i < n){
+      // Short of memory: read only the faulting page.
+      while(--i >= 0)
+        if(i != fault)
+          kfree(mem[i]);
+      mem[0] = mem[fault];
+      start = (uint)va;
+      first = slot;
+      fault = 0;
+      n = 1;
+    }
+    swapreadv(mem, first, n);
+
+    acquire(&lru_lock);
+    for(i = 0; i < n; i++){
+      if(i == fault)
+        continue;
+      // Keep a neighbour only if it is still out in that slot.
+      if(uncachedslot(pgdir, start + i*PGSIZE, first + i) < 0){
+        kfree(mem[i]);
+        continue;
+      }
+      p = pa2page(V2P(mem[i]));
+      holdslot(p, first + i);
+      addcached(p);
+      swapstat.readahead++;
+    }
+    p = newpage(mem[fault]);
+    holdslot(p, slot);
+    swapstat.major_faults++;
+    if(curproc)
+      curproc->majflt++;
+  }
+  // The PTE no longer names the slot.
+  swapfree(slot);
+  if(rmapadd(p, pgdir, va) < 0)
+    panic("swapin: rmap");
+  if(adv == MADV_SEQUENTIAL && exclusive(p))
+    p->flags |= PG_COLD;
+  // Map the page accessed but clean: it matches its swap slot,
+  // or has none and counts as dirty anyway.
+  *pte = page2pa(p) | cowflags(p, PTE_FLAGS(*pte)) | PTE_P | PTE_A;
+  release(&lru_lock);
+  return 0;
+}
+
+// Give advice about how the current process will use the pages
+// in [addr, addr+length). WILLNEED swaps them in now; DONTNEED
+// swaps them out now, keeping their contents, since xv6 has no
+// zero-filled pages to drop them to. The other advice is
+// remembered for swapin() in one of NMADV slots, replacing the
+// oldest. SEQUENTIAL and DONTNEED mark the pages already in memory
+// cold, and the other advice takes that back. Pages that another
+// mapping or swapped-out PTE shares are not marked, since the advice
+// is only about this process's use of them.
+// Returns 0, or -1 if the range or advice is bad.
+int
+madvise(uint addr, int length, int adv)
+{
+  struct proc *curproc = myproc();
+  struct madvice *m;
+  struct page *p, *cold;
+  pte_t *pte;
+  uint va, end;
+  int n;
+
+  if(addr % PGSIZE || length <= 0 || addr + length > curproc->sz ||
+     addr + length < addr || adv < MADV_NORMAL || adv > MADV_DONTNEED)
+    return -1;
+  end = PGROUNDUP(addr + length);
+
+  if(adv == MADV_WILLNEED){
+    // A failed swapin() is no error: the page is faulted in
+    // when used, as without the advice.
+    for(va = addr; va < end; va += PGSIZE)
+      swapin(curproc->pgdir, (char*)va);
+  }
+
+  acquire(&lru_lock);
+  if(adv != MADV_DONTNEED && adv != MADV_WILLNEED){
+    m = &curproc->madv[curproc->nextmadv];
+    curproc->nextmadv = (curproc->nextmadv + 1) % NMADV;
+    m->start = addr;
+    m->end = end;
+    m->advice = adv;
+  }
+  // Mark the range's pages cold, or not, and for DONTNEED move them
+  // under the CLOCK hand so they go out first.
+  cold = 0;
+  n = 0;
+  for(va = addr; va < end; va += PGSIZE){
+    pte = walkpgdir(curproc->pgdir, (char*)va, 0);
+    if(pte == 0 || (*pte & PTE_P) == 0)
+      continue;
+    p = pa2page(PTE_ADDR(*pte));
+    if((p->flags & PG_LRU) == 0)
+      continue;
+    if(adv != MADV_SEQUENTIAL && adv != MADV_DONTNEED){
+      p->flags &= ~PG_COLD;
+      continue;
+    }
+    if(!exclusive(p))
+      continue;
+    p->flags |= PG_COLD;
+    if(adv == MADV_DONTNEED){
+      update_lru(p);
+      if(cold == 0)
+        cold = p;
+      n++;
+    }
+  }
+  if(cold)
+    page_lru_head = cold;
+  release(&lru_lock);
+
+  for(; n > 0; n -= SWAPCLUSTER)
+    if(swapout() == 0)
+      break;
+  return 0;
+}
+
+// Make the page at va writable after a write fault, copying it if
+// it is shared. Returns 0 on success, 1 if the page went out of
+// memory meanwhile, -1 if the page is not writable at all or
+// memory is exhausted.
+static int
+cowbreak(pde_t *pgdir, char *va)
+{
+  struct page *p;
+  pte_t *pte;
+  char *mem;
+  uint old;
+
+  acquire(&lru_lock);
+  pte = walkpgdir(pgdir, va, 0);
+  if(!(*pte & PTE_P)){
+    release(&lru_lock);
+    return 1;
+  }
+  if(*pte & PTE_W){
+    release(&lru_lock);
+    return 0;
+  }
+  if(!(*pte & PTE_COW)){
+    release(&lru_lock);
+    return -1;
+  }
+  p = pa2page(PTE_ADDR(*pte));
+  if(!exclusive(p)){
+    old = *pte;
+    release(&lru_lock);
+    if((mem = kalloc()) == 0)
+      return -1;
+    acquire(&lru_lock);
+    if(*pte != old){
+      release(&lru_lock);
+      kfree(mem);
+      return 1;
+    }
+    if(!exclusive(p)){
+      memmove(mem, P2V(page2pa(p)), PGSIZE);
+      rmapdel(p, pgdir, va);
+      if(p->map.pgdir == 0)
+        unmapped(p);
+      p = newpage(mem);
+      rmapadd(p, pgdir, va);
+      *pte = page2pa(p) | PTE_FLAGS(*pte);
+      swapstat.cow_copies++;
+      myproc()->minflt++;
+    } else
+      kfree(mem);
+  }
+  // The page is this process's own now, whatever others advised.
+  p->flags &= ~PG_COLD;
+  *pte = (*pte & ~PTE_COW) | PTE_W;
+  flushpte(pgdir, va);
+  release(&lru_lock);
+  return 0;
+}
+
+// Handle a page fault at va with error code err: swap the page in,
+// and on a write break copy-on-write sharing.
+// Returns -1 if the access is not allowed.
+int
+pagefault(pde_t *pgdir, char *va, uint err)
+{
+  pte_t *pte;
+  int r;
+
+  va = (char*)PGROUNDDOWN((uint)va);
+  do {
+    if(swapin(pgdir, va) < 0)
+      return -1;
+    pte = walkpgdir(pgdir, va, 0);
+    if((err & FEC_U) && !(*pte & PTE_U))
+      return -1;
+    if(!(err & FEC_WR))
+      return (err & FEC_PR) ? -1 : 0;
+  } while((r = cowbreak(pgdir, va)) == 1);
+  return r;
+}
+
+// Map the present page at va in pgdir at va in the child page
+// table d too, copy-on-write for both.
+// Returns -1 if it has to be copied instead.
+int
+cowshare(pde_t *pgdir, pde_t *d, char *va)
+{
+  struct page *p;
+  pte_t *pte, *cpte;
+
+  // Allocate the page table page first: kalloc may need lru_lock.
+  if((cpte = walkpgdir(d, va, 1)) == 0)
+    return -1;
+  rmapgrow();
+  acquire(&lru_lock);
+  pte = walkpgdir(pgdir, va, 0);
+  if(!(*pte & PTE_P)){
+    release(&lru_lock);
+    return -1;
+  }
+  p = pa2page(PTE_ADDR(*pte));
+  // Once shared, writes go to copies, so the parent's PTE_D would
+  // no longer tell whether p matches its slot.
+  if(pagedirty(p))
+    dropslot(p);
+  if(rmapadd(p, d, va) < 0){
+    release(&lru_lock);
+    return -1;
+  }
+  if(*pte & PTE_W){
+    *pte = (*pte & ~PTE_W) | PTE_COW;
+    flushpte(pgdir, va);
+  }
+  *cpte = PTE_ADDR(*pte) | (PTE_FLAGS(*pte) & ~(PTE_A | PTE_D));
+  swapstat.cow_shared++;
+  release(&lru_lock);
+  return 0;
+}
+
+// Put mem, just mapped at va in pgdir, on the LRU list.
+void
+addupage(pde_t *pgdir, char *va, char *mem)
+{
+  struct page *p;
+
+  acquire(&lru_lock);
+  p = newpage(mem);
+  rmapadd(p, pgdir, va);
+  release(&lru_lock);
+}
+
+// Count the pages of [0, sz) in pgdir that are in memory (rss)
+// and in swap. The caller keeps pgdir from being freed. PTEs are
+// read without lru_lock, so the counts are only a snapshot.
+void
+vmusage(pde_t *pgdir, uint sz, int *rss, int *swapped)
+{
+  pte_t *pte;
+  uint a;
+
+  *rss = *swapped = 0;
+  for(a = 0; a < sz; a += PGSIZE){
+    if((pte = walkpgdir(pgdir, (char*)a, 0)) == 0){
+      a = PGADDR(PDX(a) + 1, 0, 0) - PGSIZE;
+      continue;
+    }
+    if(*pte & PTE_P)
+      (*rss)++;
+    else if(*pte != 0)
+      (*swapped)++;
+  }
+}
+
+// Release the user page mapped at va in pgdir, whether it is
+// in memory or in swap, and clear the PTE.
+void
+freeupage(pde_t *pgdir, char *va)
+{
+  struct page *p;
+  pte_t *pte;
+  uint pa;
+  int slot;
+
+  acquire(&lru_lock);
+  pte = walkpgdir(pgdir, va, 0);
+  if(*pte & PTE_P){
+    p = pa2page(PTE_ADDR(*pte));
+    rmapdel(p, pgdir, va);
+    if(p->map.pgdir == 0)
+      unmapped(p);
+  } else if(*pte != 0){
+    slot = PTE_ADDR(*pte) >> PTXSHIFT;
+    swapfree(slot);
+    // A cached copy nobody else refers to goes too. One being
+    // written is freed by swapout() when the write is done.
+    if((pa = swap.cache[slot]) != 0 && swap.ref[slot] == 1){
+      p = pa2page(pa);
+      if(p->flags & PG_CACHED){
+        delcached(p);
+        freepage(p);
+      }
+    }
+  }
+  *pte = 0;
+  release(&lru_lock);
+}
@@ -0,0 +1,51 @@
+// Swap activity counters, filled in by the swapstat system call.
+struct swapstat {
+  int nr_sectors_read;   // sectors read from the swap area
+  int nr_sectors_write;  // sectors written to the swap area
+  int swapouts;          // pages evicted from the LRU list
+  int writes_saved;      // clean evictions that skipped swapwrite
+  int minor_faults;      // swap-ins satisfied from the swap cache
+  int major_faults;      // swap-ins read from disk
+  int nr_cached;         // evicted pages still in memory
+  int nr_slots;          // swap slots in use
+  int nr_cmds;           // disk commands issued for swapping
+  int readahead;         // pages read around a major fault
+  int zpool_pages;       // pages of memory for the compressed pool
+  int zstored;           // swapped-out pages held compressed in the pool
+  int zbytes;            // their compressed size in bytes
+  int zhits;             // swap-ins decompressed from the pool
+  int zrejects;          // evictions sent to disk: incompressible or pool full
+  int cow_shared;        // pages shared copy-on-write by fork
+  int cow_copies;        // of those, copied on a later write
+};
+
+// Background reclaim state, read and tuned by the reclaimstat system call.
+struct reclaimstat {
+  int low;               // reclaimd wakes when free pages drop below this
+  int high;              // and evicts until there are this many
+  int nr_free;           // free pages, including clean cached ones
+  int wakeups;           // times reclaimd was woken
+  int reclaimed;         // pages evicted by reclaimd
+  int direct;            // pages reclaimed inside kalloc()
+  int direct_swapouts;   // of those, evictions done inside kalloc()
+  int scanned;           // LRU pages examined for eviction
+  uint kcycles;          // time spent reclaiming, in units of 1024 cycles
+};
+
+// madvise() advice.
+#define MADV_NORMAL     0  // default read-around and replacement
+#define MADV_RANDOM     1  // no read-around on a major fault
+#define MADV_SEQUENTIAL 2  // read ahead only, evict pages behind early
+#define MADV_WILLNEED   3  // swap the range in now
+#define MADV_DONTNEED   4  // swap the range out now
+
+// Per-process memory statistics, filled in by procvmstat.
+struct procvm {
+  int pid;
+  char name[16];
+  int rss;               // pages mapped in memory
+  int swap;              // pages swapped out
+  int minflt;            // faults served from memory
+  int majflt;            // faults that read the swap area or pool
+  uint kcycles;          // time spent reclaiming, in units of 1024 cycles
+};
@@ -7,10 +7,112 @@
 #include "syscall.h"
 #include "traps.h"
 #include "memlayout.h"
+#include "swap.h"
 
+#define PGSIZE 4096
 
-int main () {
+void
+printstat(char *when)
+{
 	int a, b;
+	struct swapstat st;
+	struct reclaimstat rs;
 
-    swapstat(&a, &b);
+	swapstat(&a, &b, &st);
+	printf(1, "%s: read %d write %d swapouts %d saved %d minor %d major %d cached %d slots %d\n",
+		when, a, b, st.swapouts, st.writes_saved, st.minor_faults,
+		st.major_faults, st.nr_cached, st.nr_slots);
+	printf(1, "%s: disk commands %d readahead %d\n",
+		when, st.nr_cmds, st.readahead);
+	printf(1, "%s: pool %d pages holds %d pages in %d bytes (ratio x%d), hits %d of %d swap-ins, rejects %d\n",
+		when, st.zpool_pages, st.zstored, st.zbytes,
+		st.zbytes ? st.zstored * PGSIZE / st.zbytes : 0,
+		st.zhits, st.zhits + st.major_faults, st.zrejects);
+	printf(1, "%s: cow shared %d copied %d\n", when, st.cow_shared, st.cow_copies);
+	reclaimstat(-1, -1, &rs);
+	printf(1, "%s: free %d (low %d high %d) reclaimd woken %d evicted %d, kalloc reclaimed %d evicted %d\n",
+		when, rs.nr_free, rs.low, rs.high, rs.wakeups, rs.reclaimed,
+		rs.direct, rs.direct_swapouts);
+}
+
+int main (int argc, char *argv[]) {
+	int i, npages;
+	char *mem;
+
+	// enough to exceed PHYSTOP and force pages out
+	npages = 58000;
+	if(argc > 1)
+		npages = atoi(argv[1]);
+
+	printstat("start");
+	if((mem = sbrk(npages * PGSIZE)) == (char*)-1){
+		printf(1, "swaptest: sbrk failed\n");
+		exit();
+	}
+	for(i = 0; i < npages; i++)
+		mem[i * PGSIZE] = i;
+	printstat("written");
+
+	// only reads: re-evicting these pages needs no swapwrite
+	for(i = 0; i < npages; i++){
+		if(mem[i * PGSIZE] != (char)i){
+			printf(1, "swaptest: page %d corrupted\n", i);
+			exit();
+		}
+	}
+	printstat("read");
+	for(i = 0; i < npages; i++){
+		if(mem[i * PGSIZE] != (char)i){
+			printf(1, "swaptest: page %d corrupted\n", i);
+			exit();
+		}
+	}
+	printstat("reread");
+
+	// a sequential scan reads ahead only and evicts behind itself;
+	// pages given DONTNEED go out at once but keep their contents
+	madvise(mem, npages * PGSIZE, MADV_SEQUENTIAL);
+	for(i = 0; i < npages; i++){
+		if(mem[i * PGSIZE] != (char)i){
+			printf(1, "swaptest: page %d corrupted\n", i);
+			exit();
+		}
+	}
+	printstat("sequential");
+	madvise(mem, npages * PGSIZE, MADV_NORMAL);
+	madvise(mem, npages / 2 * PGSIZE, MADV_DONTNEED);
+	printstat("dontneed");
+	madvise(mem, npages / 2 * PGSIZE, MADV_WILLNEED);
+	for(i = 0; i < npages; i++){
+		if(mem[i * PGSIZE] != (char)i){
+			printf(1, "swaptest: page %d corrupted\n", i);
+			exit();
+		}
+	}
+	printstat("willneed");
+
+	// the child shares the pages copy-on-write; its writes must
+	// not show through in the parent
+	if(fork() == 0){
+		for(i = 0; i < npages; i++){
+			if(mem[i * PGSIZE] != (char)i){
+				printf(1, "swaptest: child page %d corrupted\n", i);
+				exit();
+			}
+			if(i % 2)
+				mem[i * PGSIZE] = ~i;
+		}
+		printstat("child");
+		exit();
+	}
+	wait();
+	for(i = 0; i < npages; i++){
+		if(mem[i * PGSIZE] != (char)i){
+			printf(1, "swaptest: page %d changed by child\n", i);
+			exit();
+		}
+	}
+	printstat("forked");
+	printf(1, "swaptest ok\n");
+	exit();
 }
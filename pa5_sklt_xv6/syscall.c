@@ -59,12 +59,19 @@ int
 argptr(int n, char **pp, int size)
 {
   int i;
+  uint a;
   struct proc *curproc = myproc();
  
   if(argint(n, &i) < 0)
     return -1;
   if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
     return -1;
+  // Swap pages in now, before the caller takes any locks. A
+  // copy-on-write page is only copied if the kernel really writes
+  // to it, by the fault that write takes, so a buffer it only reads
+  // stays shared. No caller touches the buffer holding a spinlock.
+  for(a = PGROUNDDOWN(i); a < i+size; a += PGSIZE)
+    pagefault(curproc->pgdir, (char*)a, 0);
   *pp = (char*)i;
   return 0;
 }
@@ -106,6 +113,9 @@ extern int sys_uptime(void);
 extern int sys_swapread(void);
 extern int sys_swapwrite(void);
 extern int sys_swapstat(void);
+extern int sys_reclaimstat(void);
+extern int sys_procvmstat(void);
+extern int sys_madvise(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -132,6 +142,9 @@ static int (*syscalls[])(void) = {
 [SYS_swapread]	sys_swapread,
 [SYS_swapwrite] sys_swapwrite,
 [SYS_swapstat] sys_swapstat,
+[SYS_reclaimstat] sys_reclaimstat,
+[SYS_procvmstat] sys_procvmstat,
+[SYS_madvise] sys_madvise,
 };
 
 void
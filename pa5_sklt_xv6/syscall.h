@@ -23,3 +23,6 @@
 #define SYS_swapread	22
 #define SYS_swapwrite	23
 #define SYS_swapstat	24
+#define SYS_reclaimstat	25
+#define SYS_procvmstat	26
+#define SYS_madvise	27
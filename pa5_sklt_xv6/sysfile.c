@@ -15,6 +15,7 @@
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "swap.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
@@ -443,27 +444,40 @@ sys_pipe(void)
   return 0;
 }
 
+// The swap area is read and written by the disk interrupt
+// handler, which can't reach user memory: bounce through a
+// kernel page.
 int sys_swapread(void)
 {
 	char* ptr;
+	char* mem;
 	int blkno;
 
 	if(argptr(0, &ptr, PGSIZE) < 0 || argint(1, &blkno) < 0 )
 		return -1;
 
-	swapread(ptr, blkno);
+	if((mem = kalloc()) == 0)
+		return -1;
+	swapread(mem, blkno);
+	memmove(ptr, mem, PGSIZE);
+	kfree(mem);
 	return 0;
 }
 
 int sys_swapwrite(void)
 {
 	char* ptr;
+	char* mem;
 	int blkno;
 
 	if(argptr(0, &ptr, PGSIZE) < 0 || argint(1, &blkno) < 0 )
 		return -1;
 
-	swapwrite(ptr, blkno);
+	if((mem = kalloc()) == 0)
+		return -1;
+	memmove(mem, ptr, PGSIZE);
+	swapwrite(mem, blkno);
+	kfree(mem);
 	return 0;
 }
 
@@ -471,6 +485,8 @@ int sys_swapstat(void)
 {
 	int* nr_read;
 	int* nr_write;
+	struct swapstat* st;
+	int addr;
 	
 	if(argptr(0, (void*)&nr_read, sizeof(*nr_read)) ||
 			argptr(1, (void*)&nr_write, sizeof(*nr_write)) < 0)
@@ -478,5 +494,34 @@ int sys_swapstat(void)
 
 	*nr_read = nr_sectors_read;
 	*nr_write = nr_sectors_write;
+
+	// the detailed counters are optional
+	if(argint(2, &addr) < 0)
+		return -1;
+	if(addr != 0){
+		if(argptr(2, (void*)&st, sizeof(*st)) < 0)
+			return -1;
+		*st = swapstat;
+		st->nr_sectors_read = nr_sectors_read;
+		st->nr_sectors_write = nr_sectors_write;
+	}
+	return 0;
+}
+
+int sys_reclaimstat(void)
+{
+	int low, high, addr;
+	struct reclaimstat* st;
+
+	if(argint(0, &low) < 0 || argint(1, &high) < 0 || argint(2, &addr) < 0)
+		return -1;
+	if((low >= 0 || high >= 0) && setwatermark(low, high) < 0)
+		return -1;
+	if(addr != 0){
+		if(argptr(2, (void*)&st, sizeof(*st)) < 0)
+			return -1;
+		*st = reclaimstat;
+		st->nr_free = num_free_pages + swapstat.nr_cached;
+	}
 	return 0;
 }
@@ -6,6 +6,7 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "swap.h"
 
 int
 sys_fork(void)
@@ -89,3 +90,39 @@ sys_uptime(void)
   release(&tickslock);
   return xticks;
 }
+
+// copy the memory statistics of up to n processes to st;
+// return how many there are.
+int
+sys_procvmstat(void)
+{
+  struct procvm *st, *buf;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -1;
+  if(n > NPROC)
+    n = NPROC;
+  if(argptr(0, (void*)&st, n*sizeof(*st)) < 0)
+    return -1;
+  // Gathered under spinlocks, where touching user memory
+  // could fault, so go through a kernel page.
+  if((buf = (struct procvm*)kalloc()) == 0)
+    return -1;
+  n = procvmstat(buf, n);
+  memmove(st, buf, n*sizeof(*st));
+  kfree((char*)buf);
+  return n;
+}
+
+// give advice about how a range of memory will be used.
+int
+sys_madvise(void)
+{
+  int addr, length, advice;
+
+  if(argint(0, &addr) < 0 || argint(1, &length) < 0 ||
+     argint(2, &advice) < 0)
+    return -1;
+  return madvise(addr, length, advice);
+}
@@ -81,12 +81,10 @@ trap(struct trapframe *tf)
   //when page fault is happened, it means that the page is not in the memory
   //so we should load the page from the disk to the memory
   case T_PGFLT:
-    char* mem;
-    if((mem = kalloc()) == 0){
-      cprintf("kalloc failed\n");
-      panic("kalloc failed");
-    }
-    swapread(mem, tf->err);
+    if(myproc() && rcr2() < KERNBASE &&
+       pagefault(myproc()->pgdir, (char*)rcr2(), tf->err) == 0)
+      break;
+    // Not a swapped-out or copy-on-write page: fall through.
 
   //PAGEBREAK: 13
   default:
@@ -1,5 +1,8 @@
 struct stat;
 struct rtcdate;
+struct swapstat;
+struct reclaimstat;
+struct procvm;
 
 // system calls
 int fork(void);
@@ -25,7 +28,10 @@ int sleep(int);
 int uptime(void);
 void swapread(const char*, int);
 void swapwrite(const char*, int);
-void swapstat(int*, int*);
+void swapstat(int*, int*, struct swapstat*);
+int reclaimstat(int, int, struct reclaimstat*);
+int procvmstat(struct procvm*, int);
+int madvise(void*, int, int);
 
 // ulib.c
 int stat(const char*, struct stat*);
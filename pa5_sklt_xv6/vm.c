@@ -32,7 +32,7 @@ seginit(void)
 // Return the address of the PTE in page table pgdir
 // that corresponds to virtual address va.  If alloc!=0,
 // create any required page table pages.
-static pte_t *
+pte_t *
 walkpgdir(pde_t *pgdir, const void *va, int alloc)
 {
   pde_t *pde;
@@ -189,6 +189,7 @@ inituvm(pde_t *pgdir, char *init, uint sz)
   mem = kalloc();
   memset(mem, 0, PGSIZE);
   mappages(pgdir, 0, PGSIZE, V2P(mem), PTE_W|PTE_U);
+  addupage(pgdir, 0, mem);
   memmove(mem, init, sz);
 }
 
@@ -205,6 +206,8 @@ loaduvm(pde_t *pgdir, char *addr, struct inode *ip, uint offset, uint sz)
   for(i = 0; i < sz; i += PGSIZE){
     if((pte = walkpgdir(pgdir, addr+i, 0)) == 0)
       panic("loaduvm: address should exist");
+    if(!(*pte & PTE_P) && swapin(pgdir, addr+i) < 0)
+      return -1;
     pa = PTE_ADDR(*pte);
     if(sz - i < PGSIZE)
       n = sz - i;
@@ -244,6 +247,7 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
       kfree(mem);
       return 0;
     }
+    addupage(pgdir, (char*)a, mem);
   }
   return newsz;
 }
@@ -266,13 +270,12 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
     pte = walkpgdir(pgdir, (char*)a, 0);
     if(!pte)
       a = PGADDR(PDX(a) + 1, 0, 0) - PGSIZE;
-    else if((*pte & PTE_P) != 0){
+    else if(*pte != 0){
+      // Present or swapped out; freeupage handles both.
       pa = PTE_ADDR(*pte);
-      if(pa == 0)
+      if((*pte & PTE_P) && pa == 0)
         panic("kfree");
-      char *v = P2V(pa);
-      kfree(v);
-      *pte = 0;
+      freeupage(pgdir, (char*)a);
     }
   }
   return newsz;
@@ -311,7 +314,7 @@ clearpteu(pde_t *pgdir, char *uva)
 }
 
 // Given a parent process's page table, create a copy
-// of it for a child.
+// of it for a child. Pages are shared copy-on-write where possible.
 pde_t*
 copyuvm(pde_t *pgdir, uint sz)
 {
@@ -325,17 +328,27 @@ copyuvm(pde_t *pgdir, uint sz)
   for(i = 0; i < sz; i += PGSIZE){
     if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
       panic("copyuvm: pte should exist");
-    if(!(*pte & PTE_P))
+    if(*pte == 0)
       panic("copyuvm: page not present");
-    pa = PTE_ADDR(*pte);
-    flags = PTE_FLAGS(*pte);
+    if(swapin(pgdir, (char*)i) == 0 && cowshare(pgdir, d, (char*)i) == 0)
+      continue;
     if((mem = kalloc()) == 0)
       goto bad;
+    // Bring swapped-out pages back before copying them.
+    while(!(*pte & PTE_P)){
+      if(swapin(pgdir, (char*)i) < 0){
+        kfree(mem);
+        goto bad;
+      }
+    }
+    pa = PTE_ADDR(*pte);
+    flags = PTE_FLAGS(*pte) & ~(PTE_A | PTE_D);
     memmove(mem, (char*)P2V(pa), PGSIZE);
     if(mappages(d, (void*)i, PGSIZE, V2P(mem), flags) < 0) {
       kfree(mem);
       goto bad;
     }
+    addupage(d, (char*)i, mem);
   }
   return d;
 
@@ -371,7 +384,10 @@ copyout(pde_t *pgdir, uint va, void *p, uint len)
   buf = (char*)p;
   while(len > 0){
     va0 = (uint)PGROUNDDOWN(va);
-    pa0 = uva2ka(pgdir, (char*)va0);
+    // Swap the page in and make it private before writing it.
+    pa0 = 0;
+    if(pagefault(pgdir, (char*)va0, FEC_WR) == 0)
+      pa0 = uva2ka(pgdir, (char*)va0);
     if(pa0 == 0)
       return -1;
     n = PGSIZE - (va - va0);
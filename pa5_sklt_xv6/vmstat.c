@@ -0,0 +1,95 @@
+#include "param.h"
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "swap.h"
+
+// vmstat: report paging activity every interval seconds.
+// usage: vmstat [-p] [interval [count]]
+// The first line counts since boot, the others the interval.
+// -p adds the memory use of every process.
+
+void
+putn(int n, int width)
+{
+	int d, m;
+
+	for(d = 1, m = n < 0 ? -n : n; m >= 10; m /= 10)
+		d++;
+	if(n < 0)
+		d++;
+	for(; d < width; d++)
+		printf(1, " ");
+	printf(1, "%d", n);
+}
+
+void
+header(void)
+{
+	printf(1, "    free   cache    swap   zpool  minflt  majflt      si      so    scan   rkcyc\n");
+}
+
+void
+procs(void)
+{
+	static struct procvm st[NPROC];
+	int i, n;
+
+	n = procvmstat(st, NPROC);
+	printf(1, "     pid     rss    swap  minflt  majflt   rkcyc name\n");
+	for(i = 0; i < n; i++){
+		putn(st[i].pid, 8);
+		putn(st[i].rss, 8);
+		putn(st[i].swap, 8);
+		putn(st[i].minflt, 8);
+		putn(st[i].majflt, 8);
+		putn(st[i].kcycles, 8);
+		printf(1, " %s\n", st[i].name);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct swapstat st, ost;
+	struct reclaimstat rs, ors;
+	int a, b, i, pflag, interval, count;
+
+	pflag = 0;
+	if(argc > 1 && strcmp(argv[1], "-p") == 0){
+		pflag = 1;
+		argc--;
+		argv++;
+	}
+	interval = argc > 1 ? atoi(argv[1]) : 0;
+	count = argc > 2 ? atoi(argv[2]) : (interval ? -1 : 1);
+
+	memset(&ost, 0, sizeof(ost));
+	memset(&ors, 0, sizeof(ors));
+	for(i = 0; count < 0 || i < count; i++){
+		if(i > 0)
+			sleep(interval * 100);
+		swapstat(&a, &b, &st);
+		reclaimstat(-1, -1, &rs);
+		if(i == 0 || pflag)
+			header();
+		putn(rs.nr_free - st.nr_cached, 8);
+		putn(st.nr_cached, 8);
+		putn(st.nr_slots, 8);
+		putn(st.zstored, 8);
+		putn(st.minor_faults + st.cow_copies -
+			(ost.minor_faults + ost.cow_copies), 8);
+		putn(st.major_faults + st.zhits - (ost.major_faults + ost.zhits), 8);
+		putn(st.major_faults + st.readahead + st.zhits -
+			(ost.major_faults + ost.readahead + ost.zhits), 8);
+		putn(st.swapouts - ost.swapouts, 8);
+		putn(rs.scanned - ors.scanned, 8);
+		putn(rs.kcycles - ors.kcycles, 8);
+		printf(1, "\n");
+		if(pflag)
+			procs();
+		ost = st;
+		ors = rs;
+	}
+	exit();
+}
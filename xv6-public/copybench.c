@@ -0,0 +1,93 @@
+// Copy benchmark: bytes per 100 cycles for memmove, memset and
+// memcmp in the user library at several sizes, aligned and not,
+// and for read() of a file in the buffer cache, which copies with
+// the kernel's memmove.
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+#include "fcntl.h"
+
+#define BUFSZ  (64 * 1024)
+#define TOTAL  (1024 * 1024)  // bytes moved per measurement
+
+char src[BUFSZ + 8], dst[BUFSZ + 8];
+char *name = "copybench.dat";
+
+// Bytes per 100 cycles, from t cycles for TOTAL bytes.
+int rate(uint t)
+{
+	return t == 0 ? 0 : TOTAL / (t / 100 + 1);
+}
+
+void run(int size, int off)
+{
+	uint tmove, tset, tcmp;
+	int n = TOTAL / size;
+
+	tmove = rdtsc();
+	for (int i = 0; i < n; i++)
+		memmove(dst + off, src, size);
+	tmove = rdtsc() - tmove;
+	tset = rdtsc();
+	for (int i = 0; i < n; i++)
+		memset(dst + off, i, size);
+	tset = rdtsc() - tset;
+	memmove(dst + off, src, size);
+	tcmp = rdtsc();
+	for (int i = 0; i < n; i++)
+	{
+		if (memcmp(dst + off, src, size) != 0)
+		{
+			printf(1, "copybench: memcmp of %d bytes failed\n", size);
+			exit();
+		}
+	}
+	tcmp = rdtsc() - tcmp;
+	printf(1, "%d bytes, offset %d: memmove %d, memset %d, memcmp %d bytes/100 cycles\n",
+		   size, off, rate(tmove), rate(tset), rate(tcmp));
+}
+
+// open, read() and close a 4KB file over and over; its blocks stay
+// cached, so this is mostly copying and system call cost.
+void readrun()
+{
+	uint t;
+	int fd;
+
+	if ((fd = open(name, O_CREATE | O_RDWR)) < 0 || write(fd, src, 4096) != 4096)
+	{
+		printf(1, "copybench: cannot write %s\n", name);
+		exit();
+	}
+	close(fd);
+	t = rdtsc();
+	for (int i = 0; i < TOTAL / 4096; i++)
+	{
+		fd = open(name, O_RDONLY);
+		if (read(fd, dst, 4096) != 4096)
+		{
+			printf(1, "copybench: read failed\n");
+			exit();
+		}
+		close(fd);
+	}
+	t = rdtsc() - t;
+	printf(1, "read 4096 bytes from the cache: %d bytes/100 cycles\n", rate(t));
+	unlink(name);
+}
+
+int main(int argc, char **argv)
+{
+	static int sizes[] = {16, 64, 512, 4096, BUFSZ};
+
+	for (int i = 0; i < sizeof(src); i++)
+		src[i] = i;
+	for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		run(sizes[i], 0);
+		run(sizes[i], 3);
+	}
+	readrun();
+	exit();
+}
@@ -1,7 +1,15 @@
 struct buf;
 struct context;
+struct cpage;
 struct file;
 struct inode;
+struct lockclass;
+struct lockstat;
+struct rwlock;
+struct profsample;
+struct trapframe;
+struct traceev;
+struct mmap_area;
 struct pipe;
 struct proc;
 struct rtcdate;
@@ -24,6 +32,11 @@ void            panic(char*) __attribute__((noreturn));
 
 // exec.c
 int             exec(char*, char**);
+int             execfault(struct proc*, uint);
+void            textinit(void);
+int             textdup(uint);
+int             textput(uint);
+void            textinval(struct inode*);
 
 // file.c
 struct file*    filealloc(void);
@@ -68,10 +81,19 @@ char*           kalloc(void);
 void            kfree(char*);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
+char*           kalloclarge(void);
+void            kfreelarge(char*);
 
 // kbd.c
 void            kbdintr(void);
 
+// ktrace.c
+extern int      tracing;
+void            traceinit(void);
+void            tracerec(int, uint, uint, uint, uint, int, uint);
+int             tracectl(int);
+int             traceread(struct traceev*, int);
+
 // lapic.c
 void            cmostime(struct rtcdate *r);
 int             lapicid(void);
@@ -91,6 +113,17 @@ void            end_op();
 extern int      ismp;
 void            mpinit(void);
 
+// pcache.c
+void            pcinit(void);
+struct cpage*   pcget(struct inode*, uint);
+struct cpage*   pclookup(struct inode*, uint, int);
+void            pcput(struct cpage*);
+void            pcunget(struct cpage*);
+void            pcsync(struct inode*, uint);
+void            pcread(struct inode*, char*, uint, uint);
+void            pcwrite(struct inode*, char*, uint, uint);
+void            pcwriteback(void);
+
 // picirq.c
 void            picenable(int);
 void            picinit(void);
@@ -125,6 +158,13 @@ int             setnice(int,int); //written by SeungJaeOh
 void            ps(int); //written by SeungJaeOh
 uint            mmap(uint, int,int,int,int,int); //written by SeungJaeOh
 int             munmap(uint); //written by SeungJaeOh
+struct mmap_area* findmmap(struct proc*, uint);
+void            freemmap(struct proc*);
+int             mmapfault(struct proc*, uint, int);
+int             msync(uint, int);
+int             madvise(uint, int, int);
+void            mmapharvest(void);
+void            kthread(char*, void(*)(void));
 int             freemem(); //written by SeungJaeOh
 
 // swtch.S
@@ -138,6 +178,25 @@ void            initlock(struct spinlock*, char*);
 void            release(struct spinlock*);
 void            pushcli(void);
 void            popcli(void);
+struct lockclass* lockclass(char*, int);
+void            lockacquired(struct lockclass*, uint, uint);
+void            lockreleased(struct lockclass*, uint);
+int             lockstat(struct lockstat*, int, int);
+extern int      lockstating;
+
+// profile.c
+extern int      profiling;
+void            profinit(void);
+void            profsample(struct trapframe*);
+int             profctl(int);
+int             profread(struct profsample*, int);
+
+// rwlock.c
+void            initrwlock(struct rwlock*, char*);
+void            acquireread(struct rwlock*);
+void            releaseread(struct rwlock*);
+void            acquirewrite(struct rwlock*);
+void            releasewrite(struct rwlock*);
 
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
@@ -157,9 +216,12 @@ char*           strncpy(char*, const char*, int);
 // syscall.c
 int             argint(int, int*);
 int             argptr(int, char**, int);
+int             argwptr(int, char**, int);
 int             argstr(int, char**);
 int             fetchint(uint, int*);
 int             fetchstr(uint, char**);
+int             fetchptr(uint, char**, int);
+int             fetchwptr(uint, char**, int);
 void            syscall(void);
 
 // timer.c
@@ -189,6 +251,8 @@ int             loaduvm(pde_t*, char*, struct inode*, uint, uint);
 pde_t*          copyuvm(pde_t*, uint);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
+int             mapupage(pde_t*, uint, void*, int);
+void            vdatatick(void);
 int             copyout(pde_t*, uint, void*, uint);
 void            clearpteu(pde_t *pgdir, char *uva);
 uint*          walkpgdir(pde_t *pgdir, const void *va, int alloc);
@@ -6,16 +6,162 @@
 #include "defs.h"
 #include "x86.h"
 #include "elf.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+
+// Read-only program pages, shared by every process running the
+// same executable. A page is found by its inode and page-aligned
+// file offset while it is attached to the inode; writing the file,
+// or the inode's last reference going away, detaches the inode's
+// pages, so later execs read fresh copies while the processes
+// already mapping the old ones keep them. A page is freed when its
+// last mapping goes away.
+//
+// Additions happen with the inode's sleep lock held, so a caller
+// holding it can trust a zero ip->ntext.
+struct {
+  struct spinlock lock;
+  struct tpage {
+    struct inode *ip;   // 0 if detached or free
+    uint off;
+    char *mem;
+    int ref;            // mappings; 0 if the entry is free
+  } page[NTEXTPAGE];
+} text;
+
+void
+textinit(void)
+{
+  initlock(&text.lock, "text");
+}
+
+// Return the text page of ip at off, with a new reference, reading
+// its first n bytes if it isn't cached. Caller must hold ip->lock.
+// Returns 0 if out of memory or entries.
+static char*
+textget(struct inode *ip, uint off, uint n)
+{
+  struct tpage *t, *free;
+  char *mem;
+
+  acquire(&text.lock);
+  free = 0;
+  for(t = text.page; t < &text.page[NTEXTPAGE]; t++){
+    if(t->ip == ip && t->off == off){
+      t->ref++;
+      release(&text.lock);
+      return t->mem;
+    }
+    if(t->ref == 0 && free == 0)
+      free = t;
+  }
+  if(free == 0){
+    release(&text.lock);
+    return 0;
+  }
+  // Claimed now; ip->lock keeps anyone else from reading the page.
+  free->ref = 1;
+  release(&text.lock);
+
+  if((mem = kalloc()) != 0){
+    memset(mem, 0, PGSIZE);
+    if(readi(ip, mem, off, n) != n){
+      kfree(mem);
+      mem = 0;
+    }
+  }
+  acquire(&text.lock);
+  if(mem){
+    free->ip = ip;
+    free->off = off;
+    free->mem = mem;
+    ip->ntext++;
+  } else
+    free->ref = 0;
+  release(&text.lock);
+  return mem;
+}
+
+// Find the text page at physical address pa. Caller must hold
+// text.lock.
+static struct tpage*
+textfind(uint pa)
+{
+  struct tpage *t;
+
+  for(t = text.page; t < &text.page[NTEXTPAGE]; t++)
+    if(t->ref > 0 && t->mem == P2V(pa))
+      return t;
+  return 0;
+}
+
+// Take another reference to the text page at pa, for fork.
+// Returns -1 if pa is not a text page.
+int
+textdup(uint pa)
+{
+  struct tpage *t;
+
+  acquire(&text.lock);
+  if((t = textfind(pa)) != 0)
+    t->ref++;
+  release(&text.lock);
+  return t ? 0 : -1;
+}
+
+// Drop a reference to the text page at pa, freeing it with the
+// last one. Returns -1 if pa is not a text page.
+int
+textput(uint pa)
+{
+  struct tpage *t;
+  char *mem;
+
+  mem = 0;
+  acquire(&text.lock);
+  if((t = textfind(pa)) == 0){
+    release(&text.lock);
+    return -1;
+  }
+  if(--t->ref == 0){
+    if(t->ip)
+      t->ip->ntext--;
+    t->ip = 0;
+    mem = t->mem;
+  }
+  release(&text.lock);
+  if(mem)
+    kfree(mem);
+  return 0;
+}
+
+// Detach the text pages of ip, after it is written or before it
+// is released.
+void
+textinval(struct inode *ip)
+{
+  struct tpage *t;
+
+  acquire(&text.lock);
+  for(t = text.page; t < &text.page[NTEXTPAGE]; t++)
+    if(t->ip == ip)
+      t->ip = 0;
+  ip->ntext = 0;
+  release(&text.lock);
+}
 
 int
 exec(char *path, char **argv)
 {
   char *s, *last;
-  int i, off;
+  int i, off, nseg;
   uint argc, sz, sp, ustack[3+MAXARG+1];
   struct elfhdr elf;
-  struct inode *ip;
+  struct inode *ip, *exe;
   struct proghdr ph;
+  struct execseg seg[NEXECSEG];
   pde_t *pgdir, *oldpgdir;
   struct proc *curproc = myproc();
 
@@ -28,6 +174,7 @@ exec(char *path, char **argv)
   }
   ilock(ip);
   pgdir = 0;
+  exe = 0;
 
   // Check ELF header
   if(readi(ip, (char*)&elf, 0, sizeof(elf)) != sizeof(elf))
@@ -37,9 +184,14 @@ exec(char *path, char **argv)
 
   if((pgdir = setupkvm()) == 0)
     goto bad;
+  if(mapupage(pgdir, VPROC, curproc->vproc, PTE_U) < 0)
+    goto bad;
 
-  // Load program into memory.
+  // Load program into memory. The first NEXECSEG segments are
+  // only recorded, and read in by execfault() as they are touched;
+  // any more are loaded now.
   sz = 0;
+  nseg = 0;
   for(i=0, off=elf.phoff; i<elf.phnum; i++, off+=sizeof(ph)){
     if(readi(ip, (char*)&ph, off, sizeof(ph)) != sizeof(ph))
       goto bad;
@@ -47,15 +199,27 @@ exec(char *path, char **argv)
       continue;
     if(ph.memsz < ph.filesz)
       goto bad;
-    if(ph.vaddr + ph.memsz < ph.vaddr)
-      goto bad;
-    if((sz = allocuvm(pgdir, sz, ph.vaddr + ph.memsz)) == 0)
+    if(ph.vaddr + ph.memsz < ph.vaddr || ph.vaddr + ph.memsz >= KERNBASE)
       goto bad;
     if(ph.vaddr % PGSIZE != 0)
       goto bad;
+    if(nseg < NEXECSEG){
+      seg[nseg].vaddr = ph.vaddr;
+      seg[nseg].memsz = ph.memsz;
+      seg[nseg].off = ph.off;
+      seg[nseg].filesz = ph.filesz;
+      seg[nseg].flags = ph.flags;
+      nseg++;
+      if(ph.vaddr + ph.memsz > sz)
+        sz = ph.vaddr + ph.memsz;
+      continue;
+    }
+    if((sz = allocuvm(pgdir, sz, ph.vaddr + ph.memsz)) == 0)
+      goto bad;
     if(loaduvm(pgdir, (char*)ph.vaddr, ip, ph.off, ph.filesz) < 0)
       goto bad;
   }
+  exe = idup(ip);
   iunlockput(ip);
   end_op();
   ip = 0;
@@ -93,14 +257,30 @@ exec(char *path, char **argv)
       last = s+1;
   safestrcpy(curproc->name, last, sizeof(curproc->name));
 
-  // Commit to the user image.
+  // Commit to the user image. The mmap areas go first, while
+  // their pages are still mapped in the current page table.
+  freemmap(curproc);
   oldpgdir = curproc->pgdir;
   curproc->pgdir = pgdir;
   curproc->sz = sz;
   curproc->tf->eip = elf.entry;  // main
   curproc->tf->esp = sp;
+  memmove(curproc->seg, seg, sizeof(seg));
+  curproc->nseg = nseg;
+  ip = curproc->exe;
+  curproc->exe = exe;
   switchuvm(curproc);
   freevm(oldpgdir);
+  // The new page table has no ring.
+  if(curproc->ring){
+    kfree((char*)curproc->ring);
+    curproc->ring = 0;
+  }
+  if(ip){
+    begin_op();
+    iput(ip);
+    end_op();
+  }
   return 0;
 
  bad:
@@ -110,5 +290,77 @@ exec(char *path, char **argv)
     iunlockput(ip);
     end_op();
   }
+  if(exe){
+    begin_op();
+    iput(exe);
+    end_op();
+  }
   return -1;
 }
+
+// Read in the page of p's program holding addr after a fault on
+// it. A page of a read-only segment comes from the text cache, or
+// is a private copy if the cache is full, and is mapped read-only.
+// Returns 0 if the page is mapped, -1 if addr is not in a program
+// segment or memory is exhausted.
+int
+execfault(struct proc *p, uint addr)
+{
+  struct execseg *s;
+  pte_t *pte;
+  uint va, off, n;
+  char *mem;
+  int r, perm;
+
+  va = PGROUNDDOWN(addr);
+  if(p->exe == 0 || va >= p->sz)
+    return -1;
+  for(s = p->seg; s < &p->seg[p->nseg]; s++)
+    if(va >= s->vaddr && va < s->vaddr + s->memsz)
+      break;
+  if(s == &p->seg[p->nseg])
+    return -1;
+  if((pte = walkpgdir(p->pgdir, (char*)va, 0)) != 0 && (*pte & PTE_P))
+    return -1;
+
+  off = s->off + (va - s->vaddr);
+  n = 0;
+  if(va - s->vaddr < s->filesz){
+    n = s->filesz - (va - s->vaddr);
+    if(n > PGSIZE)
+      n = PGSIZE;
+  }
+
+  perm = PTE_W|PTE_U;
+  if(!(s->flags & ELF_PROG_FLAG_WRITE) && off % PGSIZE == 0 && n > 0){
+    ilock(p->exe);
+    mem = textget(p->exe, off, n);
+    iunlock(p->exe);
+    if(mem != 0){
+      if(mappages(p->pgdir, (char*)va, PGSIZE, V2P(mem), PTE_U) < 0){
+        textput(V2P(mem));
+        return -1;
+      }
+      return 0;
+    }
+    perm = PTE_U;
+  }
+
+  if((mem = kalloc()) == 0)
+    return -1;
+  memset(mem, 0, PGSIZE);
+  if(n > 0){
+    ilock(p->exe);
+    r = readi(p->exe, mem, off, n);
+    iunlock(p->exe);
+    if(r != n){
+      kfree(mem);
+      return -1;
+    }
+  }
+  if(mappages(p->pgdir, (char*)va, PGSIZE, V2P(mem), perm) < 0){
+    kfree(mem);
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,48 @@
+// exec benchmark: cycles to fork, exec and reap a program that
+// exits at once, and the pages the exec'd program uses when it
+// touches little of its image.
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+#define NEXEC 20
+
+int main(int argc, char **argv)
+{
+	char *args[] = {"execbench", "-c", 0};
+	uint t;
+
+	// the exec'd copy: report and leave
+	if (argc > 1)
+	{
+		if (argv[1][1] == 'v')
+			printf(1, "exec: %d pages free after exec\n", freemem());
+		exit();
+	}
+
+	t = rdtsc();
+	for (int i = 0; i < NEXEC; i++)
+	{
+		if (fork() == 0)
+		{
+			exec(args[0], args);
+			printf(1, "execbench: exec failed\n");
+			exit();
+		}
+		wait();
+	}
+	t = rdtsc() - t;
+	printf(1, "exec: %d cycles per fork+exec+wait\n", t / NEXEC);
+
+	printf(1, "exec: %d pages free before fork\n", freemem());
+	args[1] = "-v";
+	if (fork() == 0)
+	{
+		exec(args[0], args);
+		printf(1, "execbench: exec failed\n");
+		exit();
+	}
+	wait();
+	exit();
+}
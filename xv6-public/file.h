@@ -23,6 +23,18 @@ struct inode {
   short nlink;
   uint size;
   uint addrs[NDIRECT+1];
+  struct cpage *pages; // pages cached for MAP_SHARED, see pcache.c
+  int ntext;           // pages in the text cache, see exec.c
+};
+
+// a page of a file in the page cache
+struct cpage {
+  struct inode *ip;   // 0 if the entry is free
+  uint off;           // file offset, page aligned
+  char *mem;
+  int ref;            // mappings of the page
+  int dirty;          // written through a mapping, not yet written back
+  struct cpage *next; // in ip->pages
 };
 
 // table mapping major device number to
@@ -344,6 +344,14 @@ iput(struct inode *ip)
       ip->valid = 0;
     }
   }
+  if(ip->ntext){
+    // The slot may next hold another inode: its text pages must
+    // not be found under it.
+    acquire(&icache.lock);
+    if(ip->ref == 1)
+      textinval(ip);
+    release(&icache.lock);
+  }
   releasesleep(&ip->lock);
 
   acquire(&icache.lock);
@@ -472,6 +480,8 @@ readi(struct inode *ip, char *dst, uint off, uint n)
     memmove(dst, bp->data + off%BSIZE, m);
     brelse(bp);
   }
+  // pages mapped MAP_SHARED may hold newer data
+  pcread(ip, dst - n, off - n, n);
   return n;
 }
 
@@ -502,6 +512,9 @@ writei(struct inode *ip, char *src, uint off, uint n)
     log_write(bp);
     brelse(bp);
   }
+  pcwrite(ip, src - n, off - n, n);
+  if(ip->ntext)
+    textinval(ip);
 
   if(n > 0 && off > ip->size){
     ip->size = off;
@@ -27,6 +27,9 @@ struct
   struct run *freelist;
 } kmem;
 
+// Which pages are on kmem.freelist, rebuilt by kalloclarge().
+static uchar freemap[PHYSTOP / PGSIZE / 8];
+
 // Initialization happens in two phases.
 // 1. main() calls kinit1() while still using entrypgdir to place just
 // the pages mapped by entrypgdir on free list.
@@ -98,3 +101,56 @@ kalloc(void)
 
   return (char *)r;
 }
+
+// Free a 4MB page returned by kalloclarge(), back to the page
+// free list.
+void kfreelarge(char *v)
+{
+  if ((uint)v % LARGEPGSIZE || v < end || V2P(v) >= PHYSTOP)
+    panic("kfreelarge");
+  freerange(v, v + LARGEPGSIZE);
+}
+
+// Allocate one physically contiguous, 4MB aligned page, made of
+// free pages taken off the page free list. Finding them walks the
+// whole list twice with kmem.lock held, but this only runs when
+// mmap() populates a MAP_HUGE area. Returns 0 if no 4MB aligned run
+// of memory is entirely free.
+char *
+kalloclarge(void)
+{
+  struct run *r, **rp;
+  uint pa, i, n;
+  char *v;
+
+  acquire(&kmem.lock);
+  memset(freemap, 0, sizeof(freemap));
+  for (r = kmem.freelist; r; r = r->next)
+  {
+    pa = V2P(r) / PGSIZE;
+    freemap[pa / 8] |= 1 << (pa % 8);
+  }
+  v = 0;
+  pa = (V2P(end) + LARGEPGSIZE - 1) & ~(LARGEPGSIZE - 1);
+  for (; v == 0 && pa + LARGEPGSIZE <= PHYSTOP; pa += LARGEPGSIZE)
+  {
+    i = pa / PGSIZE / 8;
+    for (n = 0; n < LARGEPGSIZE / PGSIZE / 8 && freemap[i + n] == 0xff; n++)
+      ;
+    if (n == LARGEPGSIZE / PGSIZE / 8)
+      v = P2V(pa);
+  }
+  if (v)
+  {
+    for (rp = &kmem.freelist; (r = *rp) != 0;)
+    {
+      if ((char *)r >= v && (char *)r < v + LARGEPGSIZE)
+        *rp = r->next;
+      else
+        rp = &r->next;
+    }
+    free_page_cnt -= LARGEPGSIZE / PGSIZE;
+  }
+  release(&kmem.lock);
+  return v;
+}
@@ -0,0 +1,115 @@
+// Event tracing.
+//
+// While tracing is on, syscall entry and exit, context switches,
+// page faults and disk completions are recorded into a ring of the
+// CPU they happen on. Every hook tests the tracing flag first, so
+// tracing costs a load and a branch when off. Only the owning CPU
+// adds to a ring, with interrupts off, and only traceread() takes
+// events out, under trace.lock, so recording needs no lock: an
+// event is published by advancing head after it is filled in. A
+// full ring drops new events.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "trace.h"
+
+struct tracering {
+  struct traceev buf[NTRACE];
+  uint head;            // next slot to fill
+  uint tail;            // next slot to read
+  uint dropped;         // events lost to a full ring
+};
+
+struct {
+  struct spinlock lock; // serializes readers and tracectl
+  struct tracering ring[NCPU];
+} trace;
+
+int tracing;
+
+void
+traceinit(void)
+{
+  initlock(&trace.lock, "trace");
+}
+
+// Record an event of type type on this CPU.
+void
+tracerec(int type, uint a0, uint a1, uint a2, uint a3, int ret, uint cycles)
+{
+  struct tracering *r;
+  struct traceev *e;
+  struct proc *p;
+
+  pushcli();
+  r = &trace.ring[cpuid()];
+  if(r->head - r->tail >= NTRACE){
+    r->dropped++;
+    popcli();
+    return;
+  }
+  e = &r->buf[r->head % NTRACE];
+  e->tsc = rdtsc();
+  e->type = type;
+  e->cpu = cpuid();
+  p = myproc();
+  e->pid = p ? p->pid : 0;
+  e->a[0] = a0;
+  e->a[1] = a1;
+  e->a[2] = a2;
+  e->a[3] = a3;
+  e->ret = ret;
+  e->cycles = cycles;
+  // Publish the event.
+  __sync_synchronize();
+  r->head++;
+  popcli();
+}
+
+// Turn tracing on, emptying the rings, or off.
+// Returns the number of events dropped since it was last on.
+int
+tracectl(int on)
+{
+  struct tracering *r;
+  int dropped;
+
+  acquire(&trace.lock);
+  dropped = 0;
+  for(r = trace.ring; r < &trace.ring[NCPU]; r++){
+    dropped += r->dropped;
+    if(on){
+      r->tail = r->head;
+      r->dropped = 0;
+    }
+  }
+  tracing = on;
+  release(&trace.lock);
+  return dropped;
+}
+
+// Move up to n events into buf. Returns the number moved.
+int
+traceread(struct traceev *buf, int n)
+{
+  struct tracering *r;
+  int i;
+
+  acquire(&trace.lock);
+  i = 0;
+  for(r = trace.ring; r < &trace.ring[NCPU] && i < n; r++){
+    while(i < n && r->tail != *(volatile uint*)&r->head){
+      __sync_synchronize();
+      buf[i++] = r->buf[r->tail % NTRACE];
+      r->tail++;
+    }
+  }
+  release(&trace.lock);
+  return i;
+}
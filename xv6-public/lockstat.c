@@ -0,0 +1,63 @@
+// lockstat [-r] [on | off]: print the statistics of each class of
+// kernel locks, most waited for first. -r clears them afterwards.
+// The kernel only gathers them between lockstat on and lockstat off.
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "lockstat.h"
+
+struct lockstat st[NLOCKCLASS];
+
+int main(int argc, char **argv)
+{
+	struct lockstat t;
+	int n, flags;
+
+	flags = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-r") == 0)
+			flags |= LS_RESET;
+		else if (strcmp(argv[i], "on") == 0)
+			flags |= LS_ON;
+		else if (strcmp(argv[i], "off") == 0)
+			flags |= LS_OFF;
+		else
+		{
+			printf(2, "usage: lockstat [-r] [on | off]\n");
+			exit();
+		}
+	}
+	if ((n = lockstat(st, NLOCKCLASS, flags)) < 0)
+	{
+		printf(2, "lockstat: failed\n");
+		exit();
+	}
+	for (int i = 1; i < n; i++)
+	{
+		for (int j = i; j > 0 && st[j].waitk > st[j - 1].waitk; j--)
+		{
+			t = st[j];
+			st[j] = st[j - 1];
+			st[j - 1] = t;
+		}
+	}
+
+	printf(1, "name            type   acquire contend  wait(k) maxwait  hold(k) maxhold\n");
+	for (int i = 0; i < n; i++)
+	{
+		if (st[i].nacquire == 0)
+			continue;
+		printf(1, "%s", st[i].name);
+		for (int k = strlen(st[i].name); k < 16; k++)
+			printf(1, " ");
+		printf(1, "%s %d %d %d %d %d %d\n", st[i].sleep ? "sleep" : "spin ",
+			   st[i].nacquire, st[i].ncontend, st[i].waitk, st[i].maxwait,
+			   st[i].holdk, st[i].maxhold);
+		for (int k = 0; k < NLOCKSITE; k++)
+			if (st[i].sitecount[k] > 0)
+				printf(1, "    contended at 0x%x: %d\n", st[i].sitepc[k], st[i].sitecount[k]);
+	}
+	exit();
+}
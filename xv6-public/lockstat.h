@@ -0,0 +1,21 @@
+// Lock statistics, filled in by the lockstat system call. Locks are
+// counted by class: all the locks initialized with the same name.
+#define NLOCKSITE 4      // call sites kept per class
+
+// lockstat() flags.
+#define LS_RESET  1      // clear the statistics after copying them
+#define LS_ON     2      // start gathering statistics
+#define LS_OFF    4      // stop gathering statistics
+
+struct lockstat {
+  char name[16];
+  int sleep;             // 1 for sleep locks, 0 for spinlocks
+  uint nacquire;         // acquisitions
+  uint ncontend;         // acquisitions that had to wait
+  uint waitk;            // time spent waiting, in units of 1024 cycles
+  uint maxwait;          // longest wait, in cycles
+  uint holdk;            // time held, in units of 1024 cycles
+  uint maxhold;          // longest hold, in cycles
+  uint sitepc[NLOCKSITE];    // callers of the most contended acquisitions
+  uint sitecount[NLOCKSITE]; // and how many each made
+};
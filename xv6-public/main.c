@@ -10,6 +10,7 @@ static void startothers(void);
 static void mpmain(void) __attribute__((noreturn));
 extern pde_t *kpgdir;
 extern char end[]; // first address after kernel loaded from ELF file
+extern char stack[]; // boot stack, from entry.S
 
 // Bootstrap processor starts running C code here.
 // Allocate a real stack and switch to it, first
@@ -21,6 +22,7 @@ int main(void)
   mpinit();                                   // detect other processors
   lapicinit();                                // interrupt controller
   seginit();                                  // segment descriptors
+  mycpu()->stack = stack;                     // scheduler runs on it
   picinit();                                  // disable pic
   ioapicinit();                               // another interrupt controller
   consoleinit();                              // console hardware
@@ -32,7 +34,12 @@ int main(void)
   ideinit();                                  // disk
   startothers();                              // start other processors
   kinit2(P2V(4 * 1024 * 1024), P2V(PHYSTOP)); // must come after startothers()
+  pcinit();                                   // page cache
+  textinit();                                 // shared program text
+  profinit();                                 // sampling profiler
+  traceinit();                                // event tracing
   userinit();                                 // first user process
+  kthread("writeback", pcwriteback);          // write back shared mappings
   mpmain();                                   // finish this processor's setup
 }
 
@@ -65,7 +72,7 @@ startothers(void)
   extern uchar _binary_entryother_start[], _binary_entryother_size[];
   uchar *code;
   struct cpu *c;
-  char *stack;
+  char *sp;
 
   // Write entry code to unused memory at 0x7000.
   // The linker has placed the image of entryother.S in
@@ -81,8 +88,9 @@ startothers(void)
     // Tell entryother.S what stack to use, where to enter, and what
     // pgdir to use. We cannot use kpgdir yet, because the AP processor
     // is running in low  memory, so we use entrypgdir for the APs too.
-    stack = kalloc();
-    *(void **)(code - 4) = stack + KSTACKSIZE;
+    sp = kalloc();
+    c->stack = sp;
+    *(void **)(code - 4) = sp + KSTACKSIZE;
     *(void (**)(void))(code - 8) = mpenter;
     *(int **)(code - 12) = (void *)V2P(entrypgdir);
 
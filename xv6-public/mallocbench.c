@@ -0,0 +1,72 @@
+// malloc benchmark: cycles per malloc and per free for blocks of
+// several sizes, allocated in a batch and freed in a batch, and
+// for a random mix of sizes with many blocks live at once.
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+#define NBLOCK 512
+#define NMIX   20000
+
+void *blocks[NBLOCK];
+
+void batch(uint size)
+{
+	uint t, ta, tf;
+
+	t = rdtsc();
+	for (int i = 0; i < NBLOCK; i++)
+	{
+		if ((blocks[i] = malloc(size)) == 0)
+		{
+			printf(1, "mallocbench: out of memory\n");
+			exit();
+		}
+		*(char *)blocks[i] = i;
+	}
+	ta = rdtsc() - t;
+	// Every other block first, so the big ones have to merge.
+	t = rdtsc();
+	for (int i = 0; i < NBLOCK; i += 2)
+		free(blocks[i]);
+	for (int i = 1; i < NBLOCK; i += 2)
+		free(blocks[i]);
+	tf = rdtsc() - t;
+	printf(1, "size %d: malloc %d cycles, free %d cycles\n", size, ta / NBLOCK, tf / NBLOCK);
+}
+
+// Replace a random live block with one of a random size, NMIX times.
+void mix()
+{
+	uint seed = 1, t;
+
+	for (int i = 0; i < NBLOCK; i++)
+		blocks[i] = 0;
+	t = rdtsc();
+	for (int i = 0; i < NMIX; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		int k = (seed >> 8) % NBLOCK;
+		free(blocks[k]);
+		if ((blocks[k] = malloc(8 + (seed >> 20) % 4000)) == 0)
+		{
+			printf(1, "mallocbench: out of memory\n");
+			exit();
+		}
+	}
+	t = rdtsc() - t;
+	for (int i = 0; i < NBLOCK; i++)
+		free(blocks[i]);
+	printf(1, "mix of %d live blocks: %d cycles per free and malloc\n", NBLOCK, t / NMIX);
+}
+
+int main(int argc, char **argv)
+{
+	static uint sizes[] = {16, 100, 1000, 5000};
+
+	for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+		batch(sizes[i]);
+	mix();
+	exit();
+}
@@ -7,6 +7,9 @@
 // Key addresses for address space layout (see kmap in vm.c for layout)
 #define KERNBASE 0x80000000         // First kernel virtual address
 #define KERNLINK (KERNBASE+EXTMEM)  // Address where kernel is linked
+#define VDATA    0xFD000000         // struct vdata, read-only to user
+#define VPROC    (VDATA+0x1000)     // struct vproc, read-only to user
+#define VRING    (VDATA+0x2000)     // struct ring, if set up
 
 #define V2P(a) (((uint) (a)) - KERNBASE)
 #define P2V(a) ((void *)(((char *) (a)) + KERNBASE))
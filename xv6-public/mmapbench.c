@@ -0,0 +1,187 @@
+// mmap benchmark: first-touch latency and memory used by file and
+// anonymous mappings, for several fault-around windows and madvise()
+// hints, and by a file mapped MAP_SHARED in several processes.
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+#include "fcntl.h"
+#include "param.h"
+#include "mmu.h"
+
+#define FILEPAGES 16   // close to the largest file xv6 can hold
+#define ANONPAGES 1024
+#define SPARSE    16   // anonymous run touches one page in SPARSE
+#define NSHARE    4    // processes mapping the file MAP_SHARED
+
+char *name = "mmapbench.dat";
+
+void makefile()
+{
+	static char buf[PGSIZE];
+	int fd;
+
+	if ((fd = open(name, O_CREATE | O_RDWR)) < 0)
+	{
+		printf(1, "mmapbench: cannot create %s\n", name);
+		exit();
+	}
+	for (int i = 0; i < FILEPAGES; i++)
+	{
+		memset(buf, i, PGSIZE);
+		if (write(fd, buf, PGSIZE) != PGSIZE)
+		{
+			printf(1, "mmapbench: write failed\n");
+			exit();
+		}
+	}
+	close(fd);
+}
+
+// Touch every stride'th page of a FILEPAGES page file mapping
+// given madvise() advice adv.
+void filerun(int window, int stride, int adv)
+{
+	uint t, cycles = 0;
+	int fd, free0, touched = 0;
+	char *p;
+
+	faultaround(window);
+	fd = open(name, O_RDONLY);
+	free0 = freemem();
+	if ((p = (char *)mmap(0, FILEPAGES * PGSIZE, PROT_READ, 0, fd, 0)) == 0)
+	{
+		printf(1, "mmapbench: mmap failed\n");
+		exit();
+	}
+	madvise((uint)p, FILEPAGES * PGSIZE, adv);
+	for (int i = 0; i < FILEPAGES; i += stride)
+	{
+		t = rdtsc();
+		if (p[i * PGSIZE] != (char)i)
+		{
+			printf(1, "mmapbench: page %d has wrong data\n", i);
+			exit();
+		}
+		cycles += rdtsc() - t;
+		touched++;
+	}
+	printf(1, "file   window %d stride %d advice %d: %d cycles/touch, %d pages used for %d touched\n",
+		   window, stride, adv, cycles / touched, free0 - freemem(), touched);
+	munmap((uint)p);
+	close(fd);
+}
+
+// Touch one page in SPARSE of a large anonymous mapping.
+void anonrun()
+{
+	uint t, cycles = 0;
+	int free0, touched = 0;
+	char *p;
+
+	free0 = freemem();
+	if ((p = (char *)mmap(0, ANONPAGES * PGSIZE, PROT_READ | PROT_WRITE, MAP_ANONYMOUS, -1, 0)) == 0)
+	{
+		printf(1, "mmapbench: mmap failed\n");
+		exit();
+	}
+	for (int i = 0; i < ANONPAGES; i += SPARSE)
+	{
+		t = rdtsc();
+		p[i * PGSIZE] = i;
+		cycles += rdtsc() - t;
+		touched++;
+	}
+	printf(1, "anon   %d pages, 1 in %d: %d cycles/touch, %d pages used for %d touched\n",
+		   ANONPAGES, SPARSE, cycles / touched, free0 - freemem(), touched);
+	munmap((uint)p);
+}
+
+// NSHARE processes touch every page of a MAP_SHARED mapping of the
+// file; the children should add only page tables. The last one
+// writes through the mapping and calls msync, then the parent must
+// see the write both in its mapping and with read().
+void sharedrun()
+{
+	static char buf[PGSIZE];
+	int fd, free0, free1, bad;
+	char *p;
+
+	fd = open(name, O_RDWR);
+	free0 = freemem();
+	if ((p = (char *)mmap(0, FILEPAGES * PGSIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == 0)
+	{
+		printf(1, "mmapbench: shared mmap failed\n");
+		exit();
+	}
+	for (int i = 0; i < FILEPAGES; i++)
+	{
+		if (p[i * PGSIZE] != (char)i)
+		{
+			printf(1, "mmapbench: shared page %d has wrong data\n", i);
+			exit();
+		}
+	}
+	printf(1, "shared first process: %d pages used for %d pages\n", free0 - freemem(), FILEPAGES);
+
+	for (int k = 1; k < NSHARE; k++)
+	{
+		if (fork() == 0)
+		{
+			free1 = freemem();
+			for (int i = 0; i < FILEPAGES; i++)
+			{
+				if (p[i * PGSIZE] != (char)i)
+				{
+					printf(1, "mmapbench: shared page %d has wrong data\n", i);
+					exit();
+				}
+			}
+			printf(1, "shared process %d: %d pages used\n", k, free1 - freemem());
+			if (k == NSHARE - 1)
+			{
+				p[PGSIZE + 1] = 'x';
+				msync((uint)p, FILEPAGES * PGSIZE);
+			}
+			exit();
+		}
+		wait();
+	}
+
+	bad = 0;
+	if (p[PGSIZE + 1] != 'x')
+	{
+		printf(1, "mmapbench: shared write not seen in the mapping\n");
+		bad = 1;
+	}
+	if (read(fd, buf, PGSIZE) != PGSIZE || read(fd, buf, PGSIZE) != PGSIZE || buf[1] != 'x')
+	{
+		printf(1, "mmapbench: shared write not seen by read\n");
+		bad = 1;
+	}
+	printf(1, "shared %s\n", bad ? "failed" : "ok");
+	munmap((uint)p);
+	close(fd);
+}
+
+int main(int argc, char **argv)
+{
+	static int windows[] = {1, 4, 16};
+	int old;
+
+	makefile();
+	old = faultaround(0);
+	for (int i = 0; i < sizeof(windows) / sizeof(windows[0]); i++)
+	{
+		filerun(windows[i], 1, MADV_NORMAL);
+		filerun(windows[i], 4, MADV_NORMAL);
+	}
+	filerun(4, 4, MADV_RANDOM);
+	filerun(4, 1, MADV_SEQUENTIAL);
+	filerun(4, 4, MADV_WILLNEED);
+	faultaround(old);
+	anonrun();
+	sharedrun();
+	unlink(name);
+	exit();
+}
@@ -10,10 +10,26 @@
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
-#define FSSIZE       1000  // size of file system in blocks
-#define NMMAPAREA    64    // maximum number of mmap areas array, written by SeungJaeOh
+#define FSSIZE       2000  // size of file system in blocks
+#define NMMAPPAGE    16    // pages of mmap areas per process
 #define MMAPBASE     0x40000000 // base address of mmap area, written by SeungJaeOh
+#define FAULTAROUND  16    // default pages read around an mmap file fault
+#define MAXFAULTAROUND 64  // largest fault-around window
+#define NCPAGE       512   // pages in the MAP_SHARED page cache
+#define WBINTERVAL   300   // ticks between writebacks of dirty shared pages
+#define NEXECSEG     4     // program segments exec loads on demand
+#define NTEXTPAGE    256   // read-only program pages shared between processes
+#define NLOCKCLASS   64    // lock names lockstat keeps statistics for
+#define NPROFSAMPLE  512   // profiler samples buffered per CPU
+#define NTRACE       512   // trace events buffered per CPU
 #define PROT_READ    0x1
 #define PROT_WRITE   0x2
 #define MAP_ANONYMOUS 0x1
 #define MAP_POPULATE 0x2
+#define MAP_SHARED   0x4   // file mapping backed by the page cache
+#define MAP_HUGE     0x8   // back aligned anonymous MAP_POPULATE areas with 4MB pages
+#define MADV_NORMAL     0  // madvise advice
+#define MADV_RANDOM     1
+#define MADV_SEQUENTIAL 2
+#define MADV_WILLNEED   3
+#define MADV_DONTNEED   4
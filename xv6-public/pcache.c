@@ -0,0 +1,284 @@
+// Page cache for files mapped with MAP_SHARED.
+//
+// A cached page holds PGSIZE bytes of a file at a page-aligned
+// offset and sits on its inode's pages list. Every process mapping
+// that part of the file maps the same physical page, so a widely
+// mapped file costs one copy. readi() and writei() copy through a
+// cached page when there is one, which keeps them coherent with
+// the mappings.
+//
+// Writes through a mapping set PTE_D. The bit is moved into the
+// page's dirty flag when the page is unmapped, by msync(), and by
+// the writeback kernel thread, which also writes dirty pages back
+// every WBINTERVAL ticks. A page is freed, after being written back
+// if it is dirty, when its last mapping goes away.
+//
+// Locking: a page is added to or removed from an inode's list only
+// with both the inode's sleep lock and pcache.lock held, so either
+// one is enough to walk the list. ref and dirty are protected by
+// pcache.lock. Mappings hold a reference to the file, which keeps
+// the inode of each cached page alive.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+
+struct {
+  struct spinlock lock;
+  struct cpage page[NCPAGE];
+} pcache;
+
+void
+pcinit(void)
+{
+  initlock(&pcache.lock, "pcache");
+}
+
+// Return the page of ip at off with a new reference, reading it
+// in if it isn't cached. Bytes past the end of the file are zero.
+// Caller must hold ip->lock. Returns 0 if out of memory.
+struct cpage*
+pcget(struct inode *ip, uint off)
+{
+  struct cpage *cp;
+  char *mem;
+
+  acquire(&pcache.lock);
+  for(cp = ip->pages; cp; cp = cp->next){
+    if(cp->off == off){
+      cp->ref++;
+      release(&pcache.lock);
+      return cp;
+    }
+  }
+  release(&pcache.lock);
+
+  // No one else can add this page: that needs ip->lock too.
+  if((mem = kalloc()) == 0)
+    return 0;
+  memset(mem, 0, PGSIZE);
+  readi(ip, mem, off, PGSIZE);
+
+  acquire(&pcache.lock);
+  for(cp = pcache.page; cp < &pcache.page[NCPAGE]; cp++)
+    if(cp->ip == 0)
+      goto found;
+  release(&pcache.lock);
+  kfree(mem);
+  return 0;
+
+found:
+  cp->ip = ip;
+  cp->off = off;
+  cp->mem = mem;
+  cp->ref = 1;
+  cp->dirty = 0;
+  cp->next = ip->pages;
+  ip->pages = cp;
+  release(&pcache.lock);
+  return cp;
+}
+
+// Return the cached page of ip at off, marking it dirty if dirty
+// is set. The page must be cached.
+struct cpage*
+pclookup(struct inode *ip, uint off, int dirty)
+{
+  struct cpage *cp;
+
+  acquire(&pcache.lock);
+  for(cp = ip->pages; cp; cp = cp->next)
+    if(cp->off == off)
+      break;
+  if(cp == 0)
+    panic("pclookup");
+  if(dirty)
+    cp->dirty = 1;
+  release(&pcache.lock);
+  return cp;
+}
+
+// Write cp back to its file. Only the part inside the file is
+// written: a mapping never extends a file. Each piece gets its
+// own transaction, as in filewrite(). The caller holds a
+// reference to cp and must not hold the inode lock.
+static void
+pcflush(struct cpage *cp)
+{
+  struct inode *ip = cp->ip;
+  int max = ((MAXOPBLOCKS-1-1-2) / 2) * BSIZE;
+  uint off, n;
+
+  // Cleared first, so a write that races with the flush marks
+  // the page dirty again.
+  acquire(&pcache.lock);
+  cp->dirty = 0;
+  release(&pcache.lock);
+
+  for(off = 0; off < PGSIZE; off += max){
+    begin_op();
+    ilock(ip);
+    if(cp->off + off < ip->size){
+      n = ip->size - (cp->off + off);
+      if(n > max)
+        n = max;
+      if(n > PGSIZE - off)
+        n = PGSIZE - off;
+      writei(ip, cp->mem + off, cp->off + off, n);
+    }
+    iunlock(ip);
+    end_op();
+  }
+}
+
+// Drop a reference to cp. The last reference writes the page
+// back if it is dirty and frees it. Caller must not hold the
+// inode lock.
+void
+pcput(struct cpage *cp)
+{
+  struct inode *ip = cp->ip;
+  struct cpage **pp;
+  char *mem;
+
+  for(;;){
+    if(cp->ref == 1 && cp->dirty)
+      pcflush(cp);
+    ilock(ip);
+    acquire(&pcache.lock);
+    if(cp->ref > 1 || !cp->dirty)
+      break;
+    release(&pcache.lock);
+    iunlock(ip);
+  }
+
+  mem = 0;
+  if(--cp->ref == 0){
+    for(pp = &ip->pages; *pp != cp; pp = &(*pp)->next)
+      ;
+    *pp = cp->next;
+    mem = cp->mem;
+    cp->ip = 0;
+  }
+  release(&pcache.lock);
+  iunlock(ip);
+  if(mem)
+    kfree(mem);
+}
+
+// Drop a reference taken by pcget() that was never mapped, so
+// the page can't have been dirtied through it. Caller must hold
+// ip->lock.
+void
+pcunget(struct cpage *cp)
+{
+  struct inode *ip = cp->ip;
+  struct cpage **pp;
+  char *mem;
+
+  acquire(&pcache.lock);
+  mem = 0;
+  if(--cp->ref == 0 && !cp->dirty){
+    for(pp = &ip->pages; *pp != cp; pp = &(*pp)->next)
+      ;
+    *pp = cp->next;
+    mem = cp->mem;
+    cp->ip = 0;
+  }
+  release(&pcache.lock);
+  if(mem)
+    kfree(mem);
+}
+
+// Write the page of ip at off back if it is cached and dirty.
+void
+pcsync(struct inode *ip, uint off)
+{
+  struct cpage *cp;
+
+  acquire(&pcache.lock);
+  for(cp = ip->pages; cp; cp = cp->next)
+    if(cp->off == off)
+      break;
+  if(cp == 0 || !cp->dirty){
+    release(&pcache.lock);
+    return;
+  }
+  cp->ref++;
+  release(&pcache.lock);
+  pcflush(cp);
+  pcput(cp);
+}
+
+// Copy the cached parts of [off, off+n) of ip over dst, which
+// readi() has filled from the disk. Caller must hold ip->lock.
+void
+pcread(struct inode *ip, char *dst, uint off, uint n)
+{
+  struct cpage *cp;
+  uint s, e;
+
+  for(cp = ip->pages; cp; cp = cp->next){
+    s = off > cp->off ? off : cp->off;
+    e = off + n < cp->off + PGSIZE ? off + n : cp->off + PGSIZE;
+    if(s < e)
+      memmove(dst + (s - off), cp->mem + (s - cp->off), e - s);
+  }
+}
+
+// Copy src, just written to [off, off+n) of ip by writei(), into
+// the cached pages it overlaps. Caller must hold ip->lock.
+void
+pcwrite(struct inode *ip, char *src, uint off, uint n)
+{
+  struct cpage *cp;
+  uint s, e;
+
+  for(cp = ip->pages; cp; cp = cp->next){
+    s = off > cp->off ? off : cp->off;
+    e = off + n < cp->off + PGSIZE ? off + n : cp->off + PGSIZE;
+    if(s < e)
+      memmove(cp->mem + (s - cp->off), src + (s - off), e - s);
+  }
+}
+
+// Body of the writeback kernel thread.
+void
+pcwriteback(void)
+{
+  struct cpage *cp;
+  struct inode *ip;
+  uint t0;
+
+  for(;;){
+    acquire(&tickslock);
+    t0 = ticks;
+    while(ticks - t0 < WBINTERVAL)
+      sleep(&ticks, &tickslock);
+    release(&tickslock);
+
+    mmapharvest();
+    for(cp = pcache.page; cp < &pcache.page[NCPAGE]; cp++){
+      acquire(&pcache.lock);
+      if(cp->ip == 0 || !cp->dirty){
+        release(&pcache.lock);
+        continue;
+      }
+      // Hold the page and its inode: the mappings may go away
+      // while the page is written.
+      cp->ref++;
+      ip = idup(cp->ip);
+      release(&pcache.lock);
+      pcflush(cp);
+      pcput(cp);
+      begin_op();
+      iput(ip);
+      end_op();
+    }
+  }
+}
@@ -2,10 +2,108 @@
 #include "stat.h"
 #include "user.h"
 
+#define NFD    16    // NOFILE
+#define BUFSZ  512
+
+#define UNSET   0
+#define NOBUF   1    // fd 2, like stderr, or out of memory
+#define LINEBUF 2    // the console
+#define FULLBUF 3    // files and pipes
+
+// Output buffer of each fd, set up by the first write to it.
+static struct {
+  char *buf;
+  int n;
+  int mode;
+} out[NFD];
+static int lastfd = -1;  // fd most recently written
+
+extern void (*flushhook)(int);
+
+// Write out what is buffered for fd.
+void
+flush(int fd)
+{
+  if(fd < 0 || fd >= NFD || out[fd].n == 0)
+    return;
+  write(fd, out[fd].buf, out[fd].n);
+  out[fd].n = 0;
+}
+
+// Called by exit, fork and exec with -1, which flushes every fd,
+// and by close with the fd about to go, which may be reused for
+// something else.
+static void
+flushfd(int fd)
+{
+  if(fd < 0){
+    for(fd = 0; fd < NFD; fd++)
+      flush(fd);
+    return;
+  }
+  flush(fd);
+  if(fd < NFD)
+    out[fd].mode = UNSET;
+}
+
+static int
+bufmode(int fd)
+{
+  struct stat st;
+
+  if(fd == 2)
+    return NOBUF;
+  if(out[fd].buf == 0 && (out[fd].buf = malloc(BUFSZ)) == 0)
+    return NOBUF;
+  flushhook = flushfd;
+  if(fstat(fd, &st) == 0 && st.type == T_DEV)
+    return LINEBUF;
+  return FULLBUF;
+}
+
+// Write n bytes from p to fd, through its buffer. Output keeps its
+// order across fds: writing to a new fd flushes the last one.
+void
+writebuf(int fd, const void *p, int n)
+{
+  const char *s = p;
+  int i, m, nl;
+
+  if(fd < 0 || fd >= NFD){
+    write(fd, p, n);
+    return;
+  }
+  if(fd != lastfd){
+    flush(lastfd);
+    lastfd = fd;
+  }
+  if(out[fd].mode == UNSET)
+    out[fd].mode = bufmode(fd);
+  if(out[fd].mode == NOBUF){
+    write(fd, p, n);
+    return;
+  }
+
+  nl = 0;
+  while(n > 0){
+    if(out[fd].n == BUFSZ)
+      flush(fd);
+    m = BUFSZ - out[fd].n;
+    if(m > n)
+      m = n;
+    for(i = 0; i < m; i++)
+      nl |= (out[fd].buf[out[fd].n++] = s[i]) == '\n';
+    s += m;
+    n -= m;
+  }
+  if(nl && out[fd].mode == LINEBUF)
+    flush(fd);
+}
+
 static void
 putc(int fd, char c)
 {
-  write(fd, &c, 1);
+  writebuf(fd, &c, 1);
 }
 
 static void
@@ -6,6 +6,12 @@
 #include "x86.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "rwlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "trace.h"
+#include "vdata.h"
 
 // written by SeungJaeOh
 int procnicetoweight[MAXNICE - MINNICE + 1] =
@@ -18,23 +24,14 @@ int procnicetoweight[MAXNICE - MINNICE + 1] =
      /*30*/ 110, 87, 70, 56, 45,
      /*35*/ 36, 29, 23, 18, 15};
 
-struct mmap_area mmap_area_array[NMMAPAREA];
-void init_map_area_array()
-{
-  for (int i = 0; i < NMMAPAREA; i++)
-  {
-    mmap_area_array[i].f = 0;
-    mmap_area_array[i].addr = 0;
-    mmap_area_array[i].length = 0;
-    mmap_area_array[i].prot = 0;
-    mmap_area_array[i].flags = 0;
-    mmap_area_array[i].offset = 0;
-  }
-}
-
+// lock protects the table. Writers of a slot's pid or nice also
+// hold rw for writing, always after lock, so the lookups by pid
+// in kill, getnice and ps only need rw for reading and run in
+// parallel.
 struct
 {
   struct spinlock lock;
+  struct rwlock rw;
   struct proc proc[NPROC];
 } ptable;
 
@@ -45,10 +42,13 @@ extern void forkret(void);
 extern void trapret(void);
 
 static void wakeup1(void *chan);
+static struct mmap_area *mmaparea(struct proc *p, int i);
+static int insertmmap(struct proc *p, struct mmap_area *a);
 
 void pinit(void)
 {
   initlock(&ptable.lock, "ptable");
+  initrwlock(&ptable.rw, "ptable rw");
 }
 
 // Must be called with interrupts disabled
@@ -113,8 +113,11 @@ allocproc(void)
   return 0;
 
 found:
+  acquirewrite(&ptable.rw);
   p->state = EMBRYO;
   p->pid = nextpid++;
+  p->nice = DEFAULTNICE;
+  releasewrite(&ptable.rw);
 
   release(&ptable.lock);
 
@@ -124,6 +127,16 @@ found:
     p->state = UNUSED;
     return 0;
   }
+  if ((p->vproc = (struct vproc *)kalloc()) == 0)
+  {
+    kfree(p->kstack);
+    p->kstack = 0;
+    p->state = UNUSED;
+    return 0;
+  }
+  memset(p->vproc, 0, PGSIZE);
+  p->vproc->pid = p->pid;
+  p->ring = 0;
   sp = p->kstack + KSTACKSIZE;
 
   // Leave room for trap frame.
@@ -141,9 +154,10 @@ found:
   p->context->eip = (uint)forkret;
 
   // written by SeungJaeOh
-  p->nice = DEFAULTNICE;
   p->runtime = 0;
   p->vruntime = 0;
+  p->exe = 0;
+  p->nseg = 0;
   return p;
 }
 
@@ -151,14 +165,13 @@ found:
 //  Set up first user process.
 void userinit(void)
 {
-  void init_map_area_array();
   struct proc *p;
   extern char _binary_initcode_start[], _binary_initcode_size[];
 
   p = allocproc();
 
   initproc = p;
-  if ((p->pgdir = setupkvm()) == 0)
+  if ((p->pgdir = setupkvm()) == 0 || mapupage(p->pgdir, VPROC, p->vproc, PTE_U) < 0)
     panic("userinit: out of memory?");
   inituvm(p->pgdir, _binary_initcode_start, (int)_binary_initcode_size);
   p->sz = PGSIZE;
@@ -185,6 +198,26 @@ void userinit(void)
   release(&ptable.lock);
 }
 
+// Start a kernel thread that runs fn, which must never return.
+// The thread has only the kernel part of an address space and
+// never enters user space.
+void kthread(char *name, void (*fn)(void))
+{
+  struct proc *p;
+
+  if ((p = allocproc()) == 0)
+    panic("kthread: no proc");
+  if ((p->pgdir = setupkvm()) == 0)
+    panic("kthread: out of memory?");
+  // forkret returns into fn instead of trapret.
+  *(uint *)(p->context + 1) = (uint)fn;
+  safestrcpy(p->name, name, sizeof(p->name));
+
+  acquire(&ptable.lock);
+  p->state = RUNNABLE;
+  release(&ptable.lock);
+}
+
 // Grow current process's memory by n bytes.
 // Return 0 on success, -1 on failure.
 int growproc(int n)
@@ -226,40 +259,29 @@ int fork(void)
   // Copy process state from proc.
   if ((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0)
   {
+    kfree((char *)np->vproc);
+    np->vproc = 0;
     kfree(np->kstack);
     np->kstack = 0;
     np->state = UNUSED;
     return -1;
   }
-  // copy mmap_area information into child process from parent process
-  int copy_mmap_area = 0;
-  for (int i = 0; i < NMMAPAREA && copy_mmap_area == 0; ++i)
+  // copy every mmap area into child process from parent process
+  for (i = 0; i < curproc->nmmap; i++)
   {
-    if (mmap_area_array[i].p == curproc)
-    {
-      for (int j = 0; j < NMMAPAREA; ++j)
-      {
-        if (j == i)
-        {
-          continue;
-        }
-        if (mmap_area_array[j].p == 0)
-        {
-          mmap_area_array[j].f = mmap_area_array[i].f;
-          mmap_area_array[j].addr = mmap_area_array[i].addr;
-          mmap_area_array[j].length = mmap_area_array[i].length;
-          mmap_area_array[j].offset = mmap_area_array[i].offset;
-          mmap_area_array[j].prot = mmap_area_array[i].prot;
-          mmap_area_array[j].flags = mmap_area_array[i].flags;
-          mmap_area_array[j].p = np;
-          copy_mmap_area = 1;
-          break;
-        }
-      }
-    }
+    if (insertmmap(np, mmaparea(curproc, i)) < 0)
+      goto bad;
   }
+  if (mapupage(np->pgdir, VPROC, np->vproc, PTE_U) < 0)
+    goto bad;
 
   np->sz = curproc->sz;
+  if (curproc->exe)
+  {
+    np->exe = idup(curproc->exe);
+  }
+  memmove(np->seg, curproc->seg, sizeof(curproc->seg));
+  np->nseg = curproc->nseg;
   np->parent = curproc;
   *np->tf = *curproc->tf;
 
@@ -286,6 +308,17 @@ int fork(void)
 
   release(&ptable.lock);
   return pid;
+
+bad:
+  freemmap(np);
+  freevm(np->pgdir);
+  np->pgdir = 0;
+  kfree((char *)np->vproc);
+  np->vproc = 0;
+  kfree(np->kstack);
+  np->kstack = 0;
+  np->state = UNUSED;
+  return -1;
 }
 
 // Exit the current process.  Does not return.
@@ -310,10 +343,17 @@ void exit(void)
     }
   }
 
+  freemmap(curproc);
+
   begin_op();
   iput(curproc->cwd);
+  if (curproc->exe)
+  {
+    iput(curproc->exe);
+  }
   end_op();
   curproc->cwd = 0;
+  curproc->exe = 0;
 
   acquire(&ptable.lock);
 
@@ -361,12 +401,21 @@ int wait(void)
         pid = p->pid;
         kfree(p->kstack);
         p->kstack = 0;
+        kfree((char *)p->vproc);
+        p->vproc = 0;
+        if (p->ring)
+        {
+          kfree((char *)p->ring);
+          p->ring = 0;
+        }
         freevm(p->pgdir);
+        acquirewrite(&ptable.rw);
         p->pid = 0;
         p->parent = 0;
         p->name[0] = 0;
         p->killed = 0;
         p->state = UNUSED;
+        releasewrite(&ptable.rw);
         release(&ptable.lock);
         return pid;
       }
@@ -493,6 +542,8 @@ void scheduler(void)
     switchuvm(min_vruntime_proc);
 
     min_vruntime_proc->state = RUNNING;
+    if (tracing)
+      tracerec(TR_SWITCH, min_vruntime_proc->pid, 0, 0, 0, 0, 0);
 
     swtch(&(c->scheduler), min_vruntime_proc->context);
     switchkvm();
@@ -638,21 +689,26 @@ int kill(int pid)
 {
   struct proc *p;
 
-  acquire(&ptable.lock);
+  acquireread(&ptable.rw);
   for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
   {
     if (p->pid == pid)
     {
       p->killed = 1;
-      // Wake process from sleep if necessary.
-      if (p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
-      return 0;
+      break;
     }
   }
+  releaseread(&ptable.rw);
+  if (p == &ptable.proc[NPROC])
+    return -1;
+
+  // Wake process from sleep if necessary. A reader can't take
+  // ptable.lock, so look again under it.
+  acquire(&ptable.lock);
+  if (p->pid == pid && p->state == SLEEPING)
+    p->state = RUNNABLE;
   release(&ptable.lock);
-  return -1;
+  return 0;
 }
 
 // PAGEBREAK: 36
@@ -698,6 +754,7 @@ int getnice(int pid)
   struct proc *p;
 
   int return_value = -1;
+  acquireread(&ptable.rw);
   for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
   {
     if (p->pid != pid)
@@ -707,6 +764,7 @@ int getnice(int pid)
     return_value = p->nice;
     break;
   }
+  releaseread(&ptable.rw);
   return return_value;
 }
 
@@ -721,6 +779,7 @@ int setnice(int pid, int value)
     return return_value;
   }
 
+  acquirewrite(&ptable.rw);
   for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
   {
     if (p->pid != pid)
@@ -731,6 +790,7 @@ int setnice(int pid, int value)
     return_value = 0;
     break;
   }
+  releasewrite(&ptable.rw);
   return return_value;
 }
 
@@ -753,28 +813,41 @@ void ps(int pid)
   struct proc *p;
   char *state;
   int first_output = 1;
+  char name[16];
+  int ppid, nice, runtime, vruntime;
+  enum procstate pstate;
 
   uint xticks; // to get ticks
   // if pid==0 print all processes' information and pid!=0 print corresponding process's information
 
+  acquire(&tickslock);
+  xticks = ticks;
+  release(&tickslock);
   for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
   {
-    if (p->state == UNUSED || (pid != 0 && p->pid != pid))
+    // Copy the slot out: printing takes cons.lock, which a reader
+    // of ptable.rw must not do.
+    acquireread(&ptable.rw);
+    pstate = p->state;
+    ppid = p->pid;
+    safestrcpy(name, p->name, sizeof(name));
+    nice = p->nice;
+    runtime = p->runtime;
+    vruntime = p->vruntime;
+    releaseread(&ptable.rw);
+    if (pstate == UNUSED || (pid != 0 && ppid != pid))
     {
       continue;
     }
 
     if (first_output)
     {
-      acquire(&tickslock);
-      xticks = ticks;
-      release(&tickslock);
       cprintf("name\tpid\tstate\t\tpriority\truntime/weight\truntime\tvruntime\ttick%d\n", MILLIBIAS * xticks);
       first_output = 0;
     }
 
-    state = states[p->state];
-    cprintf("%s\t%d\t%s\t%d\t\t%d\t\t%d\t%d\n", p->name, p->pid, state, p->nice, p->runtime / procnicetoweight[p->nice], p->runtime, p->vruntime);
+    state = states[pstate];
+    cprintf("%s\t%d\t%s\t%d\t\t%d\t\t%d\t%d\n", name, ppid, state, nice, runtime / procnicetoweight[nice], runtime, vruntime);
     if (pid != 0)
     {
       break;
@@ -782,133 +855,645 @@ void ps(int pid)
   }
 }
 
+// Each process keeps its mmap areas sorted by address in an array
+// spread over kalloc'd pages: area i is p->mmap[i / MMAPPERPAGE]
+// [i % MMAPPERPAGE]. Pages are allocated as the array grows and
+// freed with the process.
+static struct mmap_area *
+mmaparea(struct proc *p, int i)
+{
+  return &p->mmap[i / MMAPPERPAGE][i % MMAPPERPAGE];
+}
+
+// Binary search for the first area of p that ends above addr.
+// Returns p->nmmap if there is none.
+static int
+mmapindex(struct proc *p, uint addr)
+{
+  struct mmap_area *a;
+  int lo = 0, hi = p->nmmap, mid;
+
+  while (lo < hi)
+  {
+    mid = (lo + hi) / 2;
+    a = mmaparea(p, mid);
+    if (a->addr + a->length <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+// Return the mmap area of p covering addr, or 0 if there is none.
+struct mmap_area *
+findmmap(struct proc *p, uint addr)
+{
+  struct mmap_area *a;
+  int i;
+
+  i = mmapindex(p, addr);
+  if (i == p->nmmap)
+    return 0;
+  a = mmaparea(p, i);
+  if (addr < a->addr)
+    return 0;
+  return a;
+}
+
+// Add a copy of *a to p's areas, keeping them sorted. The area
+// holds a reference to its file. Fails if it overlaps an existing
+// area or memory runs out.
+static int
+insertmmap(struct proc *p, struct mmap_area *a)
+{
+  int i, j, pg;
+
+  i = mmapindex(p, a->addr);
+  if (i < p->nmmap && mmaparea(p, i)->addr < a->addr + a->length)
+    return -1;
+  pg = p->nmmap / MMAPPERPAGE;
+  if (pg == NMMAPPAGE)
+    return -1;
+  if (p->mmap[pg] == 0)
+  {
+    if ((p->mmap[pg] = (struct mmap_area *)kalloc()) == 0)
+      return -1;
+  }
+  for (j = p->nmmap; j > i; j--)
+    *mmaparea(p, j) = *mmaparea(p, j - 1);
+  *mmaparea(p, i) = *a;
+  p->nmmap++;
+  if (a->f)
+    filedup(a->f);
+  return 0;
+}
+
+// The area is taken out before its file is closed, which may
+// sleep, so mmapharvest() never sees an area with a closed file.
+static void
+removemmap(struct proc *p, int i)
+{
+  struct file *f;
+
+  f = mmaparea(p, i)->f;
+  p->nmmap--;
+  for (; i < p->nmmap; i++)
+    *mmaparea(p, i) = *mmaparea(p, i + 1);
+  if (f)
+    fileclose(f);
+}
+
+static void unmaprange(struct proc *p, struct mmap_area *a, uint start, uint end);
+
+// Unmap all of p's mmap areas and drop them and the pages holding
+// them.
+void freemmap(struct proc *p)
+{
+  int n;
+
+  for (int i = 0; i < p->nmmap; i++)
+  {
+    unmaprange(p, mmaparea(p, i), mmaparea(p, i)->addr, mmaparea(p, i)->addr + mmaparea(p, i)->length);
+  }
+  n = p->nmmap;
+  p->nmmap = 0;
+  for (int i = 0; i < n; i++)
+  {
+    if (mmaparea(p, i)->f)
+      fileclose(mmaparea(p, i)->f);
+  }
+  for (int i = 0; i < NMMAPPAGE; i++)
+  {
+    if (p->mmap[i])
+    {
+      kfree((char *)p->mmap[i]);
+      p->mmap[i] = 0;
+    }
+  }
+}
+
+// Replace the large page mapped by *pde with a page table that maps
+// the same memory as 4KB pages, which kalloclarge() took off the
+// page free list one by one and kfree() can take back. Returns -1
+// if there is no page for the page table.
+static int
+splitlarge(pde_t *pde)
+{
+  pte_t *pgtab;
+  uint pa;
+
+  if ((pgtab = (pte_t *)kalloc()) == 0)
+  {
+    return -1;
+  }
+  pa = PTE_ADDR(*pde);
+  for (int i = 0; i < NPTENTRIES; i++)
+  {
+    pgtab[i] = (pa + i * PGSIZE) | (PTE_FLAGS(*pde) & ~PTE_PS);
+  }
+  *pde = V2P(pgtab) | PTE_P | PTE_W | PTE_U;
+  return 0;
+}
+
+// Unmap the pages of area a in [start, end) of p's page table.
+// Private pages are freed. Shared ones go back to the page cache,
+// marked dirty if they were written through this mapping. A large
+// page only partly in the range is split first; if that fails for
+// lack of memory, it stays mapped.
+static void
+unmaprange(struct proc *p, struct mmap_area *a, uint start, uint end)
+{
+  struct cpage *cp;
+  pde_t *pde;
+  pte_t *pte;
+
+  for (uint va = start; va < end; va += PGSIZE)
+  {
+    pde = &p->pgdir[PDX(va)];
+    if (*pde & PTE_PS)
+    {
+      if (va % LARGEPGSIZE == 0 && va + LARGEPGSIZE <= end)
+      {
+        kfreelarge(P2V(PTE_ADDR(*pde)));
+        *pde = 0;
+        va += LARGEPGSIZE - PGSIZE;
+        continue;
+      }
+      if (splitlarge(pde) < 0)
+      {
+        va = (va & ~(LARGEPGSIZE - 1)) + LARGEPGSIZE - PGSIZE;
+        continue;
+      }
+    }
+    pte = walkpgdir(p->pgdir, (const void *)va, 0);
+    if (pte == 0 || (*pte & PTE_P) == 0)
+    {
+      continue;
+    }
+    if (a->flags & MAP_SHARED)
+    {
+      cp = pclookup(a->f->ip, a->offset + (va - a->addr), *pte & PTE_D);
+      *pte = 0;
+      pcput(cp);
+    }
+    else
+    {
+      kfree(P2V(PTE_ADDR(*pte)));
+      *pte = 0;
+    }
+  }
+}
+
+// Move the PTE_D bits of a shared area's pages in [start, end)
+// to their page cache entries.
+static void
+harvest(pde_t *pgdir, struct mmap_area *a, uint start, uint end)
+{
+  pte_t *pte;
+
+  for (uint va = start; va < end; va += PGSIZE)
+  {
+    pte = walkpgdir(pgdir, (const void *)va, 0);
+    if (pte != 0 && (*pte & (PTE_P | PTE_D)) == (PTE_P | PTE_D))
+    {
+      *pte &= ~PTE_D;
+      pclookup(a->f->ip, a->offset + (va - a->addr), 1);
+    }
+  }
+}
+
+// Called by the writeback thread to find pages written through
+// shared mappings. A running process may have PTE_D cached in its
+// TLB, so clearing the bit could lose later writes: it is skipped
+// and its pages are found by msync, munmap or exit instead. The
+// others reload %cr3 before they run again.
+void mmapharvest(void)
+{
+  struct proc *p;
+  struct mmap_area *a;
+
+  acquire(&ptable.lock);
+  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+  {
+    if (p->state == UNUSED || p->state == EMBRYO || p->state == RUNNING)
+    {
+      continue;
+    }
+    for (int i = 0; i < p->nmmap; i++)
+    {
+      a = mmaparea(p, i);
+      if (a->flags & MAP_SHARED)
+      {
+        harvest(p->pgdir, a, a->addr, a->addr + a->length);
+      }
+    }
+  }
+  release(&ptable.lock);
+}
+
+// Pages read in around a fault on a file mapping, so a scan of
+// the file takes one fault per window rather than one per page.
+// Set with the faultaround system call.
+int faultaround = FAULTAROUND;
+
+// Map the page at va of area a. A shared area maps the file's
+// page from the page cache. Otherwise a new page is allocated:
+// zeroes for an anonymous area, or the file contents at the
+// matching offset, read straight from the inode. The caller holds
+// the inode lock of a file area.
+static int
+mmappage(struct proc *p, struct mmap_area *a, uint va)
+{
+  struct cpage *cp;
+  char *mem;
+  int perm;
+
+  perm = PTE_U;
+  if (a->prot & PROT_WRITE)
+  {
+    perm |= PTE_W;
+  }
+  if (a->flags & MAP_SHARED)
+  {
+    if ((cp = pcget(a->f->ip, a->offset + (va - a->addr))) == 0)
+    {
+      return -1;
+    }
+    if (mappages(p->pgdir, (void *)va, PGSIZE, V2P(cp->mem), perm) < 0)
+    {
+      pcunget(cp);
+      return -1;
+    }
+    return 0;
+  }
+
+  if ((mem = kalloc()) == 0)
+  {
+    return -1;
+  }
+  memset(mem, 0, PGSIZE);
+  // a page past the end of the file stays zero
+  if ((a->flags & MAP_ANONYMOUS) == 0)
+  {
+    readi(a->f->ip, mem, a->offset + (va - a->addr), PGSIZE);
+  }
+  if (mappages(p->pgdir, (void *)va, PGSIZE, V2P(mem), perm) < 0)
+  {
+    kfree(mem);
+    return -1;
+  }
+  return 0;
+}
+
+// Map the 4MB at va of anonymous area a with one large page, if
+// it lies wholly inside a, no page table covers it yet and a large
+// page is free.
+static int
+mmaplarge(struct proc *p, struct mmap_area *a, uint va)
+{
+  pde_t *pde;
+  char *mem;
+
+  if (va % LARGEPGSIZE != 0 || va + LARGEPGSIZE > a->addr + a->length)
+  {
+    return -1;
+  }
+  pde = &p->pgdir[PDX(va)];
+  if (*pde & PTE_P)
+  {
+    return -1;
+  }
+  if ((mem = kalloclarge()) == 0)
+  {
+    return -1;
+  }
+  memset(mem, 0, LARGEPGSIZE);
+  *pde = V2P(mem) | PTE_PS | PTE_P | PTE_U;
+  if (a->prot & PROT_WRITE)
+  {
+    *pde |= PTE_W;
+  }
+  return 0;
+}
+
+static int
+mapped(pde_t *pgdir, uint va)
+{
+  pte_t *pte;
+
+  if (pgdir[PDX(va)] & PTE_PS)
+  {
+    return 1;
+  }
+  pte = walkpgdir(pgdir, (const void *)va, 0);
+  return pte != 0 && (*pte & PTE_P);
+}
+
+// Unmap the pages of file area a in [start, end) that can be read
+// back from the file: shared ones, and private ones never written.
+static void
+dropbehind(struct proc *p, struct mmap_area *a, uint start, uint end)
+{
+  pte_t *pte;
+
+  for (uint va = start; va < end; va += PGSIZE)
+  {
+    pte = walkpgdir(p->pgdir, (const void *)va, 0);
+    if (pte == 0 || (*pte & PTE_P) == 0)
+    {
+      continue;
+    }
+    if ((a->flags & MAP_SHARED) || (*pte & PTE_D) == 0)
+    {
+      unmaprange(p, a, va, va + PGSIZE);
+    }
+  }
+  lcr3(V2P(p->pgdir));
+}
+
+// Handle a page fault at addr in one of p's mmap areas by mapping
+// the faulting page, and for a file area the unmapped pages of the
+// fault-around window holding it that lie within the file. The
+// window follows the area's madvise() advice.
+// Returns -1 if addr is in no area or the access isn't allowed.
+int mmapfault(struct proc *p, uint addr, int write)
+{
+  struct mmap_area *a;
+  struct inode *ip;
+  uint va, start, end;
+  int window;
+
+  if ((a = findmmap(p, addr)) == 0)
+  {
+    return -1;
+  }
+  if (write && (a->prot & PROT_WRITE) == 0)
+  {
+    return -1;
+  }
+  va = PGROUNDDOWN(addr);
+  // present already: a protection fault
+  if (mapped(p->pgdir, va))
+  {
+    return -1;
+  }
+  if (a->flags & MAP_ANONYMOUS)
+  {
+    return mmappage(p, a, va);
+  }
+
+  window = faultaround;
+  if (a->advice == MADV_RANDOM)
+  {
+    window = 1;
+  }
+  else if (a->advice == MADV_SEQUENTIAL)
+  {
+    window = MAXFAULTAROUND;
+  }
+
+  ip = a->f->ip;
+  ilock(ip);
+  if (mmappage(p, a, va) < 0)
+  {
+    iunlock(ip);
+    return -1;
+  }
+  start = va - (va - a->addr) % (window * PGSIZE);
+  end = start + window * PGSIZE;
+  if (end > a->addr + a->length)
+  {
+    end = a->addr + a->length;
+  }
+  for (uint i = start; i < end && a->offset + (i - a->addr) < ip->size; i += PGSIZE)
+  {
+    if (i != va && !mapped(p->pgdir, i) && mmappage(p, a, i) < 0)
+    {
+      break;
+    }
+  }
+  iunlock(ip);
+
+  // a sequential reader is done with the window before last
+  if (a->advice == MADV_SEQUENTIAL && start - a->addr >= 2 * window * PGSIZE)
+  {
+    dropbehind(p, a, start - 2 * window * PGSIZE, start - window * PGSIZE);
+  }
+  return 0;
+}
+
+// Advise how [addr, addr+length) will be used. The range must
+// overlap some mmap area. MADV_NORMAL, MADV_RANDOM and
+// MADV_SEQUENTIAL set the fault-around policy of each area the range
+// touches: RANDOM reads only the faulting page, SEQUENTIAL reads
+// MAXFAULTAROUND pages and drops those left well behind. WILLNEED
+// reads the file pages of the range in now. DONTNEED unmaps the
+// range; it reads back from the file, or as zeroes, on next touch.
+int madvise(uint addr, int length, int advice)
+{
+  struct proc *curproc = myproc();
+  struct mmap_area *a;
+  uint start, end;
+  int i, found;
+
+  if (addr % PGSIZE != 0 || length <= 0 || advice < MADV_NORMAL || advice > MADV_DONTNEED)
+  {
+    return -1;
+  }
+  found = 0;
+  for (i = mmapindex(curproc, addr); i < curproc->nmmap; i++)
+  {
+    a = mmaparea(curproc, i);
+    if (a->addr >= addr + length)
+    {
+      break;
+    }
+    found = 1;
+    start = addr > a->addr ? addr : a->addr;
+    end = addr + length < a->addr + a->length ? addr + length : a->addr + a->length;
+    switch (advice)
+    {
+    case MADV_WILLNEED:
+      if (a->flags & MAP_ANONYMOUS)
+      {
+        break;
+      }
+      ilock(a->f->ip);
+      for (uint va = start; va < end && a->offset + (va - a->addr) < a->f->ip->size; va += PGSIZE)
+      {
+        if (!mapped(curproc->pgdir, va) && mmappage(curproc, a, va) < 0)
+        {
+          break;
+        }
+      }
+      iunlock(a->f->ip);
+      break;
+    case MADV_DONTNEED:
+      unmaprange(curproc, a, start, end);
+      break;
+    default:
+      a->advice = advice;
+    }
+  }
+  lcr3(V2P(curproc->pgdir));
+  return found ? 0 : -1;
+}
+
 // If succeed, return the start address of mapping area, If failed, return 0
 // If MAP_ANONYMOUS is given, it is anonyous mapping
 // If MAP_ANONYMOUS is not given, it is file mapping
 // If MAP_POPULATE is given, allocate physical page & make page table for whole mapping area.
 // If MAP_POPULATE is not given, just record its mapping area.
+// If MAP_SHARED is given, the file's pages are shared through the page cache
+// and writes reach the file; offset must be page aligned.
+// If MAP_HUGE is given with MAP_ANONYMOUS and MAP_POPULATE, each 4MB aligned
+// part of the area gets one large page while there are any; the rest gets
+// small pages.
+// Fails if the area overlaps one the process already has.
 uint mmap(uint addr, int length, int prot, int flags, int fd, int offset)
 {
+  struct mmap_area area;
+
   if (addr % PGSIZE != 0 || length <= 0 || length % PGSIZE != 0)
   {
-    goto bad;
+    return 0;
   }
   struct proc *curproc = myproc();
 
   // Describe failed situation
   // It's not anonumous, but when the fd is -1
   // The protection of the file and the prot of the parameter are different
-  if ((flags & MAP_ANONYMOUS) == 0 && fd == -1)
+  if ((flags & MAP_ANONYMOUS) == 0 && (fd < 0 || fd >= NOFILE))
   {
-    goto bad;
+    return 0;
   }
-  // if flags have MAP_POPULATE, allocate physical page & make page table for whole mapping area.
   struct file *f = 0;
   if ((flags & MAP_ANONYMOUS) == 0)
   {
     f = curproc->ofile[fd];
+    if (f == 0 || f->type != FD_INODE || !f->readable)
+    {
+      return 0;
+    }
   }
-  if (flags & MAP_POPULATE)
+  if (flags & MAP_SHARED)
   {
-    char *mem;
-    char buf[PGSIZE];
-    for (int i = addr + MMAPBASE; i < addr + length + MMAPBASE; i += PGSIZE)
+    if (f == 0 || offset % PGSIZE != 0 || ((prot & PROT_WRITE) && !f->writable))
     {
+      return 0;
+    }
+  }
 
-      // if failed to allocate physical page, return 0
-      // 일단 고려하지 않는다.
-      if ((mem = kalloc()) == 0)
-      {
-        goto bad;
-      }
+  // record the area first so an overlapping mapping is refused
+  // before any page is mapped
+  area.f = f;
+  area.addr = addr + MMAPBASE;
+  area.length = length;
+  area.offset = offset;
+  area.prot = prot;
+  area.flags = flags;
+  area.advice = MADV_NORMAL;
+  if (insertmmap(curproc, &area) < 0)
+  {
+    return 0;
+  }
 
-      // set memory as 0
-      if (flags & MAP_ANONYMOUS)
+  // if flags have MAP_POPULATE, allocate physical page & make page table for whole mapping area.
+  if (flags & MAP_POPULATE)
+  {
+    if (f)
+    {
+      ilock(f->ip);
+    }
+    for (uint i = area.addr; i < area.addr + length; i += PGSIZE)
+    {
+      if ((flags & (MAP_HUGE | MAP_ANONYMOUS)) == (MAP_HUGE | MAP_ANONYMOUS) && mmaplarge(curproc, &area, i) == 0)
       {
-        memset(mem, 0, PGSIZE);
+        i += LARGEPGSIZE - PGSIZE;
+        continue;
       }
-      // set memory from fd
-      else
+      // if failed to allocate physical page, return 0
+      if (mmappage(curproc, &area, i) < 0)
       {
-        if (f == 0)
+        if (f)
         {
-          goto bad;
+          iunlock(f->ip);
         }
-        while (offset > 0)
-        {
-          if (offset >= PGSIZE)
-          {
-            fileread(f, buf, PGSIZE);
-            offset -= PGSIZE;
-          }
-          else
-          {
-            fileread(f, buf, offset);
-            offset = 0;
-          }
-        }
-        int n;
-        n = fileread(f, buf, PGSIZE);
-        memmove(mem, buf, n);
+        goto bad;
       }
-      mappages(curproc->pgdir, (void *)i, PGSIZE, V2P(mem), PTE_W | PTE_U);
     }
-  }
-
-  // store mmap_area information into mmap_area_array
-  for (int i = 0; i < NMMAPAREA; ++i)
-  {
-    if (mmap_area_array[i].p == 0)
+    if (f)
     {
-      mmap_area_array[i].f = f;
-      mmap_area_array[i].addr = addr + MMAPBASE;
-      mmap_area_array[i].length = length;
-      mmap_area_array[i].offset = offset;
-      mmap_area_array[i].prot = prot;
-      mmap_area_array[i].flags = flags;
-      mmap_area_array[i].p = curproc;
-      return addr + MMAPBASE;
+      iunlock(f->ip);
     }
   }
+  return area.addr;
 
 bad:
   // dealloc memory table
+  unmaprange(curproc, &area, area.addr, area.addr + length);
+  removemmap(curproc, mmapindex(curproc, area.addr));
   return 0;
 }
 
 int munmap(uint addr)
 {
   struct proc *curproc = myproc();
-  for (int i = 0; i < NMMAPAREA; ++i)
+  struct mmap_area *a;
+  int i;
+
+  i = mmapindex(curproc, addr);
+  if (i == curproc->nmmap)
   {
-    if (mmap_area_array[i].p == curproc && mmap_area_array[i].addr == addr)
-    {
-      pte_t *pte;
-      uint pa;
+    return -1;
+  }
+  a = mmaparea(curproc, i);
+  if (a->addr != addr)
+  {
+    return -1;
+  }
+  unmaprange(curproc, a, addr, addr + a->length);
+  lcr3(V2P(curproc->pgdir));
+  removemmap(curproc, i);
+  return 1;
+}
 
-      for (int j = addr; j < addr + mmap_area_array[i].length; j += PGSIZE)
-      {
-        pte = walkpgdir(curproc->pgdir, (const void *)j, 0);
-        if (pte == 0)
-        {
-          continue;
-        }
-        pa = PTE_ADDR(*pte);
-        char *v = P2V(pa);
-        kfree(v);
-      }
+// Write the pages of shared mappings in [addr, addr+length) that
+// were written through back to their files. Returns -1 if part of
+// the range is not mapped.
+int msync(uint addr, int length)
+{
+  struct proc *curproc = myproc();
+  struct mmap_area *a;
+  uint va;
 
-      mmap_area_array[i].f = 0;
-      mmap_area_array[i].addr = 0;
-      mmap_area_array[i].length = 0;
-      mmap_area_array[i].offset = 0;
-      mmap_area_array[i].prot = 0;
-      mmap_area_array[i].flags = 0;
-      mmap_area_array[i].p = 0;
-      return 1;
+  if (addr % PGSIZE != 0 || length <= 0)
+  {
+    return -1;
+  }
+  for (va = addr; va < addr + length; va += PGSIZE)
+  {
+    if ((a = findmmap(curproc, va)) == 0)
+    {
+      return -1;
+    }
+    if (a->flags & MAP_SHARED)
+    {
+      harvest(curproc->pgdir, a, va, va + PGSIZE);
     }
   }
-  return -1;
+  // drop the cleared PTE_D bits from the TLB
+  lcr3(V2P(curproc->pgdir));
+  for (va = addr; va < addr + length; va += PGSIZE)
+  {
+    a = findmmap(curproc, va);
+    if (a->flags & MAP_SHARED)
+    {
+      pcsync(a->f->ip, a->offset + (va - a->addr));
+    }
+  }
+  return 0;
 }
 
 extern int free_page_cnt;
@@ -916,4 +1501,4 @@ extern int free_page_cnt;
 int freemem()
 {
   return free_page_cnt;
-}
\ No newline at end of file
+}
@@ -8,6 +8,7 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
+  char *stack;                 // Bottom of the scheduler's stack
 };
 
 extern struct cpu cpus[NCPU];
@@ -38,11 +39,23 @@ enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 #define MAXNICE 39 //written by SeungJaeOh
 #define DEFAULTNICE 20 //written by SeungJaeOh
 
+// A program segment of the executable, read in a page at a time
+// as it is touched.
+struct execseg {
+  uint vaddr;                  // page aligned
+  uint memsz;
+  uint off;                    // file offset of vaddr
+  uint filesz;                 // bytes from the file; the rest is zero
+  uint flags;                  // ELF_PROG_FLAG_*
+};
+
 // Per-process state
 struct proc {
   uint sz;                     // Size of process memory (bytes)
   pde_t* pgdir;                // Page table
   char *kstack;                // Bottom of kernel stack for this process
+  struct vproc *vproc;         // Page mapped read-only at VPROC
+  struct ring *ring;           // Page mapped at VRING, or 0
   enum procstate state;        // Process state
   int pid;                     // Process ID
   struct proc *parent;         // Parent process
@@ -56,6 +69,11 @@ struct proc {
   int nice;                    // written by SeungJaeOh Lower nice values cause more favorable scheduling
   int runtime;                 // written by SeungJaeOh
   int vruntime;                // written by SeungJaeOh
+  struct mmap_area *mmap[NMMAPPAGE]; // mmap areas sorted by address, MMAPPERPAGE to a page
+  int nmmap;                   // number of mmap areas
+  struct inode *exe;           // Executable the segments are read from
+  struct execseg seg[NEXECSEG]; // Program segments loaded on demand
+  int nseg;                    // number of segments in seg
 };
 
 // written by SeungJaeOh PA03
@@ -67,10 +85,11 @@ struct mmap_area
   int offset;
   int prot;
   int flags;
-  struct proc *p;
-  /* data */
+  int advice; // MADV_*, set by madvise
 };
 
+#define MMAPPERPAGE (PGSIZE / sizeof(struct mmap_area))
+
 // Process memory is laid out contiguously, low addresses first:
 //   text
 //   original data and bss
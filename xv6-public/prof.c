@@ -0,0 +1,281 @@
+// prof [-f] command [args...]: run command with the sampling
+// profiler on, then print a flat profile of where the CPUs were
+// interrupted while running it or its children, or with -f the
+// folded call chains (root first, one "frame;frame;... count" line
+// per distinct chain). Samples of idle CPUs and other processes are
+// only counted. Kernel pcs are resolved against kernel.sym; user pcs
+// are shown as [user].
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "param.h"
+#include "profile.h"
+
+#define MAXSAMPLE (NCPU * NPROFSAMPLE)
+#define MAXSTACK  512   // distinct call chains kept for -f
+#define USER      -1    // frame in user code
+#define UNKNOWN   -2    // kernel pc below every symbol
+
+int nsym;
+uint *symaddr;
+char **symname;
+
+struct profsample samples[MAXSAMPLE];
+int stacks[MAXSTACK][PROFDEPTH];
+int stackcount[MAXSTACK];
+
+uint hex(char *s, char **end)
+{
+	uint v = 0;
+
+	for (;; s++)
+	{
+		if (*s >= '0' && *s <= '9')
+			v = v * 16 + *s - '0';
+		else if (*s >= 'a' && *s <= 'f')
+			v = v * 16 + *s - 'a' + 10;
+		else
+			break;
+	}
+	*end = s;
+	return v;
+}
+
+// Load kernel.sym, "address name" per line, sorted by address.
+void loadsyms()
+{
+	struct stat st;
+	char *buf, *p, *e;
+	int fd, n;
+
+	if ((fd = open("kernel.sym", O_RDONLY)) < 0 || fstat(fd, &st) < 0)
+	{
+		printf(2, "prof: cannot read kernel.sym\n");
+		return;
+	}
+	buf = malloc(st.size + 1);
+	n = read(fd, buf, st.size);
+	close(fd);
+	buf[n < 0 ? 0 : n] = 0;
+
+	for (p = buf; *p; p++)
+		if (*p == '\n')
+			nsym++;
+	symaddr = malloc(nsym * sizeof(uint));
+	symname = malloc(nsym * sizeof(char *));
+	nsym = 0;
+	for (p = buf; *p; p = e + 1)
+	{
+		symaddr[nsym] = hex(p, &e);
+		if (*e != ' ')
+			break;
+		symname[nsym] = ++e;
+		while (*e && *e != '\n')
+			e++;
+		if (*e == 0)
+			break;
+		*e = 0;
+		nsym++;
+	}
+
+	// insertion sort by address
+	for (int i = 1; i < nsym; i++)
+	{
+		uint a = symaddr[i];
+		char *s = symname[i];
+		int j;
+		for (j = i; j > 0 && symaddr[j - 1] > a; j--)
+		{
+			symaddr[j] = symaddr[j - 1];
+			symname[j] = symname[j - 1];
+		}
+		symaddr[j] = a;
+		symname[j] = s;
+	}
+}
+
+// Index of the symbol holding kernel pc, or UNKNOWN.
+int lookup(uint pc)
+{
+	int lo = 0, hi = nsym;
+
+	// find the last symbol at or below pc
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (symaddr[mid] <= pc)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo == 0 ? UNKNOWN : lo - 1;
+}
+
+char *framename(int f)
+{
+	if (f == USER)
+		return "[user]";
+	if (f == UNKNOWN)
+		return "[unknown]";
+	return symname[f];
+}
+
+// Resolve the call chain of s into frames, leaf first; returns
+// how many.
+int frames(struct profsample *s, int *f)
+{
+	int n;
+
+	for (n = 0; n < PROFDEPTH && s->pc[n] != 0; n++)
+		f[n] = s->user ? USER : lookup(s->pc[n]);
+	// a run of user frames says no more than one
+	if (s->user)
+		n = 1;
+	return n;
+}
+
+int member(int *set, int n, int pid)
+{
+	for (int i = 0; i < n; i++)
+		if (set[i] == pid)
+			return 1;
+	return 0;
+}
+
+// Keep only the samples of pid and its descendants, which are found
+// through the parent pids the samples carry, and count the rest in
+// *idle (no process) and *other. Returns how many are kept.
+int keep(int n, int pid, int *idle, int *other)
+{
+	int family[NPROC], nfamily, changed, m;
+
+	family[0] = pid;
+	nfamily = 1;
+	do
+	{
+		changed = 0;
+		for (int i = 0; i < n && nfamily < NPROC; i++)
+		{
+			if (member(family, nfamily, samples[i].ppid) && !member(family, nfamily, samples[i].pid))
+			{
+				family[nfamily++] = samples[i].pid;
+				changed = 1;
+			}
+		}
+	} while (changed);
+
+	m = *idle = *other = 0;
+	for (int i = 0; i < n; i++)
+	{
+		if (member(family, nfamily, samples[i].pid))
+			samples[m++] = samples[i];
+		else if (samples[i].pid == 0)
+			(*idle)++;
+		else
+			(*other)++;
+	}
+	return m;
+}
+
+void flat(int n)
+{
+	int *count, f[PROFDEPTH], best, k;
+
+	count = malloc((nsym + 2) * sizeof(int));
+	memset(count, 0, (nsym + 2) * sizeof(int));
+	for (int i = 0; i < n; i++)
+	{
+		frames(&samples[i], f);
+		count[f[0] + 2]++;
+	}
+	printf(1, "samples  %%    function\n");
+	for (k = 0; k < 20; k++)
+	{
+		best = 0;
+		for (int i = 1; i < nsym + 2; i++)
+			if (count[i] > count[best])
+				best = i;
+		if (count[best] == 0)
+			break;
+		printf(1, "%d\t %d\t%s\n", count[best], count[best] * 100 / n, framename(best - 2));
+		count[best] = 0;
+	}
+}
+
+void folded(int n)
+{
+	int f[PROFDEPTH], m, k, nstack = 0;
+
+	for (int i = 0; i < n; i++)
+	{
+		m = frames(&samples[i], f);
+		for (; m < PROFDEPTH; m++)
+			f[m] = 0x7fffffff;
+		for (k = 0; k < nstack; k++)
+		{
+			for (m = 0; m < PROFDEPTH && stacks[k][m] == f[m]; m++)
+				;
+			if (m == PROFDEPTH)
+				break;
+		}
+		if (k == nstack)
+		{
+			if (nstack == MAXSTACK)
+				continue;
+			memmove(stacks[nstack++], f, sizeof(f));
+		}
+		stackcount[k]++;
+	}
+	for (k = 0; k < nstack; k++)
+	{
+		for (m = PROFDEPTH - 1; m >= 0; m--)
+		{
+			if (stacks[k][m] == 0x7fffffff)
+				continue;
+			printf(1, "%s%s", framename(stacks[k][m]), m > 0 ? ";" : "");
+		}
+		printf(1, " %d\n", stackcount[k]);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int fold, n, r, dropped, pid, idle, other;
+
+	fold = argc > 1 && strcmp(argv[1], "-f") == 0;
+	if (argc < 2 + fold)
+	{
+		printf(2, "usage: prof [-f] command [args...]\n");
+		exit();
+	}
+	loadsyms();
+
+	profctl(1);
+	if ((pid = fork()) == 0)
+	{
+		exec(argv[1 + fold], argv + 1 + fold);
+		printf(2, "prof: exec %s failed\n", argv[1 + fold]);
+		exit();
+	}
+	wait();
+	dropped = profctl(0);
+
+	n = 0;
+	while (n < MAXSAMPLE && (r = profread(samples + n, MAXSAMPLE - n)) > 0)
+		n += r;
+	if (dropped > 0)
+		printf(2, "prof: %d samples dropped\n", dropped);
+	n = keep(n, pid, &idle, &other);
+	printf(2, "prof: %d samples, %d idle, %d of other processes\n", n, idle, other);
+	if (n == 0)
+	{
+		printf(1, "prof: no samples\n");
+		exit();
+	}
+	if (fold)
+		folded(n);
+	else
+		flat(n);
+	exit();
+}
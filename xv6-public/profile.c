@@ -0,0 +1,147 @@
+// Sampling CPU profiler.
+//
+// While profiling is on, every timer interrupt records the eip it
+// interrupted and a short frame-pointer call chain into a ring of
+// its CPU. Only that CPU adds to its ring, with interrupts off, and
+// only profread() takes samples out, under prof.lock, so the rings
+// need no lock on the sampling side: the producer publishes a
+// sample by advancing head after filling it in. A full ring drops
+// new samples.
+//
+// User call chains are followed only through pages that are
+// present, and kernel ones only within the interrupted stack, since
+// the timer interrupt can't take a page fault.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "profile.h"
+
+struct profring {
+  struct profsample buf[NPROFSAMPLE];
+  uint head;            // next slot to fill
+  uint tail;            // next slot to read
+  uint dropped;         // samples lost to a full ring
+};
+
+struct {
+  struct spinlock lock; // serializes readers and profctl
+  struct profring ring[NCPU];
+} prof;
+
+int profiling;
+
+void
+profinit(void)
+{
+  initlock(&prof.lock, "prof");
+}
+
+// Read the word at user address va of p, if it is mapped.
+static int
+fetchuser(struct proc *p, uint va, uint *w)
+{
+  pte_t *pte;
+
+  if(va % 4 != 0 || va >= p->sz || va + 4 > p->sz)
+    return -1;
+  pte = walkpgdir(p->pgdir, (char*)va, 0);
+  if(pte == 0 || (*pte & (PTE_P|PTE_U)) != (PTE_P|PTE_U))
+    return -1;
+  *w = *(uint*)P2V(PTE_ADDR(*pte) + (va & (PGSIZE-1)));
+  return 0;
+}
+
+// Record a sample of the code interrupted with trap frame tf.
+// Called from the timer interrupt.
+void
+profsample(struct trapframe *tf)
+{
+  struct profring *r = &prof.ring[cpuid()];
+  struct profsample *s;
+  struct proc *p = myproc();
+  uint ebp, lo, hi, w[2];
+  int i;
+
+  if(r->head - r->tail >= NPROFSAMPLE){
+    r->dropped++;
+    return;
+  }
+  s = &r->buf[r->head % NPROFSAMPLE];
+  s->pid = p ? p->pid : 0;
+  s->ppid = p && p->parent ? p->parent->pid : 0;
+  s->cpu = cpuid();
+  s->user = (tf->cs & 3) == DPL_USER;
+  s->pc[0] = tf->eip;
+  ebp = tf->ebp;
+  // A kernel call chain is followed only within the stack the
+  // interrupt came in on, and below the trap frame that entered the
+  // kernel: trap() called from there saved the user's %ebp.
+  lo = (uint)tf;
+  hi = p ? (uint)p->tf : (uint)mycpu()->stack + KSTACKSIZE;
+  for(i = 1; i < PROFDEPTH; i++){
+    if(s->user){
+      if(fetchuser(p, ebp, &w[0]) < 0 || fetchuser(p, ebp + 4, &w[1]) < 0)
+        break;
+    } else {
+      if(ebp < lo || ebp + 8 > hi)
+        break;
+      w[0] = ((uint*)ebp)[0];
+      w[1] = ((uint*)ebp)[1];
+    }
+    s->pc[i] = w[1];    // saved %eip
+    ebp = w[0];         // saved %ebp
+  }
+  for(; i < PROFDEPTH; i++)
+    s->pc[i] = 0;
+  // Publish the sample.
+  __sync_synchronize();
+  r->head++;
+}
+
+// Turn profiling on, emptying the rings, or off.
+// Returns the number of samples dropped since it was last on.
+int
+profctl(int on)
+{
+  struct profring *r;
+  int dropped;
+
+  acquire(&prof.lock);
+  dropped = 0;
+  for(r = prof.ring; r < &prof.ring[NCPU]; r++){
+    dropped += r->dropped;
+    if(on){
+      r->tail = r->head;
+      r->dropped = 0;
+    }
+  }
+  profiling = on;
+  release(&prof.lock);
+  return dropped;
+}
+
+// Move up to n samples into buf. Returns the number moved.
+int
+profread(struct profsample *buf, int n)
+{
+  struct profring *r;
+  int i;
+
+  acquire(&prof.lock);
+  i = 0;
+  for(r = prof.ring; r < &prof.ring[NCPU] && i < n; r++){
+    while(i < n && r->tail != *(volatile uint*)&r->head){
+      __sync_synchronize();
+      buf[i++] = r->buf[r->tail % NPROFSAMPLE];
+      r->tail++;
+    }
+  }
+  release(&prof.lock);
+  return i;
+}
@@ -0,0 +1,10 @@
+// A profiler sample, read by the profread system call.
+#define PROFDEPTH 6      // pcs kept per sample
+
+struct profsample {
+  int pid;               // process interrupted, 0 if none
+  int ppid;              // its parent, 0 if none
+  int cpu;
+  int user;              // 1 if interrupted in user mode
+  uint pc[PROFDEPTH];    // interrupted eip, then its callers; 0 ends
+};
@@ -0,0 +1,36 @@
+// Submission and completion rings, shared between a process and
+// the kernel at VRING (see ringsetup() in sysfile.c). The process
+// fills sq[sqtail % NRINGENT] and advances sqtail; ringenter()
+// carries out the queued operations in order and posts one
+// completion each, with the submission's data, at cqtail. The
+// process reads completions from cqhead.
+
+#define RING_READ   1    // read(fd, addr, len)
+#define RING_WRITE  2    // write(fd, addr, len)
+#define RING_OPEN   3    // open(addr, len as the mode)
+#define RING_CLOSE  4    // close(fd)
+#define RING_FSYNC  5    // write back fd's dirty cached pages
+
+#define NRINGENT 64
+
+struct sqe {
+  int op;              // RING_*
+  int fd;
+  uint addr;
+  int len;
+  uint data;           // returned in the completion
+};
+
+struct cqe {
+  uint data;
+  int res;             // what the system call would return
+};
+
+struct ring {
+  uint sqhead;         // written by the kernel
+  uint sqtail;         // written by the process
+  uint cqhead;         // written by the process
+  uint cqtail;         // written by the kernel
+  struct sqe sq[NRINGENT];
+  struct cqe cq[NRINGENT];
+};
@@ -0,0 +1,125 @@
+// Ring benchmark: write and read back a file in small pieces, one
+// system call per piece and then through the submission ring, a
+// batch of NRINGENT pieces per ringenter().
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+#include "fcntl.h"
+#include "ring.h"
+
+#define PIECE  64
+#define NPIECE 1024
+
+char *name = "ringbench.dat";
+char buf[NPIECE * PIECE];
+struct ring *r;
+
+void submit(int op, int fd, char *addr, int len, uint data)
+{
+	struct sqe *e = &r->sq[r->sqtail % NRINGENT];
+
+	e->op = op;
+	e->fd = fd;
+	e->addr = (uint)addr;
+	e->len = len;
+	e->data = data;
+	__sync_synchronize();
+	r->sqtail++;
+}
+
+// Run the queued operations and check that each returned want.
+void complete(int want)
+{
+	struct cqe *c;
+
+	ringenter();
+	while (r->cqhead != r->cqtail)
+	{
+		c = &r->cq[r->cqhead % NRINGENT];
+		if (c->res != want)
+		{
+			printf(1, "ringbench: operation %d returned %d\n", c->data, c->res);
+			exit();
+		}
+		r->cqhead++;
+	}
+}
+
+// Write or read the file a piece at a time, with system calls or
+// through the ring.
+void run(int useread, int usering)
+{
+	uint t;
+	int fd;
+
+	fd = open(name, useread ? O_RDONLY : O_CREATE | O_RDWR);
+	if (fd < 0)
+	{
+		printf(1, "ringbench: cannot open %s\n", name);
+		exit();
+	}
+	t = rdtsc();
+	for (int i = 0; i < NPIECE; i++)
+	{
+		if (usering)
+		{
+			submit(useread ? RING_READ : RING_WRITE, fd, buf + i * PIECE, PIECE, i);
+			if ((i + 1) % NRINGENT == 0)
+				complete(PIECE);
+		}
+		else if ((useread ? read(fd, buf + i * PIECE, PIECE) : write(fd, buf + i * PIECE, PIECE)) != PIECE)
+		{
+			printf(1, "ringbench: piece %d failed\n", i);
+			exit();
+		}
+	}
+	if (usering)
+		complete(PIECE);
+	t = rdtsc() - t;
+	close(fd);
+	printf(1, "%s %s: %d cycles/piece\n", useread ? "read " : "write",
+		   usering ? "ring    " : "syscalls", t / NPIECE);
+}
+
+int main(int argc, char **argv)
+{
+	if ((r = (struct ring *)ringsetup()) == 0)
+	{
+		printf(1, "ringbench: ringsetup failed\n");
+		exit();
+	}
+	for (int i = 0; i < sizeof(buf); i++)
+		buf[i] = i;
+	run(0, 0);
+	run(1, 0);
+	unlink(name);
+	run(0, 1);
+	memset(buf, 0, sizeof(buf));
+	run(1, 1);
+	for (int i = 0; i < sizeof(buf); i++)
+	{
+		if (buf[i] != (char)i)
+		{
+			printf(1, "ringbench: byte %d read back wrong\n", i);
+			exit();
+		}
+	}
+
+	// An open, then a write, fsync and close in one batch: the fd
+	// isn't known until the open completes.
+	submit(RING_OPEN, 0, name, O_RDWR, 0);
+	ringenter();
+	submit(RING_WRITE, r->cq[r->cqhead % NRINGENT].res, buf, PIECE, 1);
+	submit(RING_FSYNC, r->cq[r->cqhead % NRINGENT].res, 0, 0, 2);
+	submit(RING_CLOSE, r->cq[r->cqhead % NRINGENT].res, 0, 0, 3);
+	r->cqhead++;
+	ringenter();
+	if (r->cq[r->cqhead % NRINGENT].res != PIECE || r->cq[(r->cqhead + 1) % NRINGENT].res != 0 ||
+		r->cq[(r->cqhead + 2) % NRINGENT].res != 0)
+		printf(1, "ringbench: open/write/fsync/close batch failed\n");
+	else
+		printf(1, "ringbench: ok\n");
+	unlink(name);
+	exit();
+}
@@ -0,0 +1,43 @@
+// Process table lookup benchmark: NCHILD processes call getnice()
+// and kill() on a pid that does not exist, so every call scans the
+// whole table. With ptable.rw the scans on different CPUs run in
+// parallel. Run lockstat -r before and lockstat after to see the
+// contention on "ptable rw".
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+#define NCHILD   4
+#define NLOOKUP  20000
+#define NOPID    1000000
+
+int main(int argc, char **argv)
+{
+	uint t;
+	int start;
+
+	start = uptime();
+	for (int k = 0; k < NCHILD; k++)
+	{
+		if (fork() == 0)
+		{
+			t = rdtsc();
+			for (int i = 0; i < NLOOKUP; i++)
+			{
+				if (getnice(getpid()) < 0 || kill(NOPID) == 0)
+				{
+					printf(1, "rwbench: lookup failed\n");
+					exit();
+				}
+			}
+			t = rdtsc() - t;
+			printf(1, "rwbench: child %d: %d cycles per getnice+kill\n", k, t / NLOOKUP);
+			exit();
+		}
+	}
+	for (int k = 0; k < NCHILD; k++)
+		wait();
+	printf(1, "rwbench: %d children, %d ticks\n", NCHILD, uptime() - start);
+	exit();
+}
@@ -0,0 +1,90 @@
+// Reader-writer spin locks, for tables that are mostly scanned and
+// rarely changed. Readers on different CPUs hold the lock at once.
+// A writer first claims RW_WRITER, which keeps new readers out, and
+// then waits for the readers already in to leave, so a stream of
+// readers can't starve it.
+//
+// Like a spinlock, either side keeps interrupts off while it holds
+// the lock. A reader must not acquire other locks: a writer may
+// spin for it while holding ptable.lock.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "x86.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "rwlock.h"
+
+void
+initrwlock(struct rwlock *rw, char *name)
+{
+  rw->name = name;
+  rw->cnt = 0;
+  rw->lc = lockclass(name, 0);
+}
+
+void
+acquireread(struct rwlock *rw)
+{
+  uint c, t0, wait;
+
+  pushcli();
+  t0 = lockstating ? rdtsc() : 0;
+  wait = 0;
+  for(;;){
+    c = *(volatile uint*)&rw->cnt;
+    if((c & RW_WRITER) == 0 && cmpxchg(&rw->cnt, c, c + 1) == c)
+      break;
+    wait = 1;
+    pause();
+  }
+  __sync_synchronize();
+  if(lockstating && rw->lc)
+    lockacquired(rw->lc, wait ? rdtsc() - t0 : 0, (uint)__builtin_return_address(0));
+}
+
+void
+releaseread(struct rwlock *rw)
+{
+  __sync_synchronize();
+  if((fetchadd(&rw->cnt, -1) & ~RW_WRITER) == 0)
+    panic("releaseread");
+  popcli();
+}
+
+void
+acquirewrite(struct rwlock *rw)
+{
+  uint c, t0, wait;
+
+  pushcli();
+  t0 = lockstating ? rdtsc() : 0;
+  wait = 0;
+  // Claim the writer bit, then wait for the readers to drain.
+  for(;;){
+    c = *(volatile uint*)&rw->cnt;
+    if((c & RW_WRITER) == 0 && cmpxchg(&rw->cnt, c, c | RW_WRITER) == c)
+      break;
+    wait = 1;
+    pause();
+  }
+  while(*(volatile uint*)&rw->cnt != RW_WRITER){
+    wait = 1;
+    pause();
+  }
+  __sync_synchronize();
+  if(lockstating && rw->lc)
+    lockacquired(rw->lc, wait ? rdtsc() - t0 : 0, (uint)__builtin_return_address(0));
+}
+
+void
+releasewrite(struct rwlock *rw)
+{
+  if(rw->cnt != RW_WRITER)
+    panic("releasewrite");
+  __sync_synchronize();
+  xchg(&rw->cnt, 0);
+  popcli();
+}
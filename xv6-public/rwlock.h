@@ -0,0 +1,11 @@
+// Reader-writer spin lock: any number of readers, or one writer.
+struct rwlock {
+  uint cnt;          // Readers holding the lock, plus RW_WRITER if a
+                     // writer holds it or is waiting for readers.
+
+  // For debugging:
+  char *name;        // Name of lock.
+  struct lockclass *lc; // Statistics for lockstat.
+};
+
+#define RW_WRITER 0x80000000
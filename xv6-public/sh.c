@@ -53,6 +53,10 @@ int fork1(void);  // Fork but panics on failure.
 void panic(char*);
 struct cmd *parsecmd(char*);
 
+// The parsed command line's nodes, all freed at once when the
+// command is done.
+struct arena *cmdarena;
+
 // Execute cmd.  Never returns.
 void
 runcmd(struct cmd *cmd)
@@ -155,6 +159,9 @@ main(void)
     }
   }
 
+  if((cmdarena = arenacreate()) == 0)
+    panic("arenacreate");
+
   // insert by SeungJae Oh
   printf(1,"Student ID: 2020314916\n");
   printf(1,"Name: SeungJae Oh\n");
@@ -172,6 +179,7 @@ main(void)
     if(fork1() == 0)
       runcmd(parsecmd(buf));
     wait();
+    arenareset(cmdarena);
   }
   exit();
 }
@@ -202,7 +210,7 @@ execcmd(void)
 {
   struct execcmd *cmd;
 
-  cmd = malloc(sizeof(*cmd));
+  cmd = arenaalloc(cmdarena, sizeof(*cmd));
   memset(cmd, 0, sizeof(*cmd));
   cmd->type = EXEC;
   return (struct cmd*)cmd;
@@ -213,7 +221,7 @@ redircmd(struct cmd *subcmd, char *file, char *efile, int mode, int fd)
 {
   struct redircmd *cmd;
 
-  cmd = malloc(sizeof(*cmd));
+  cmd = arenaalloc(cmdarena, sizeof(*cmd));
   memset(cmd, 0, sizeof(*cmd));
   cmd->type = REDIR;
   cmd->cmd = subcmd;
@@ -229,7 +237,7 @@ pipecmd(struct cmd *left, struct cmd *right)
 {
   struct pipecmd *cmd;
 
-  cmd = malloc(sizeof(*cmd));
+  cmd = arenaalloc(cmdarena, sizeof(*cmd));
   memset(cmd, 0, sizeof(*cmd));
   cmd->type = PIPE;
   cmd->left = left;
@@ -242,7 +250,7 @@ listcmd(struct cmd *left, struct cmd *right)
 {
   struct listcmd *cmd;
 
-  cmd = malloc(sizeof(*cmd));
+  cmd = arenaalloc(cmdarena, sizeof(*cmd));
   memset(cmd, 0, sizeof(*cmd));
   cmd->type = LIST;
   cmd->left = left;
@@ -255,7 +263,7 @@ backcmd(struct cmd *subcmd)
 {
   struct backcmd *cmd;
 
-  cmd = malloc(sizeof(*cmd));
+  cmd = arenaalloc(cmdarena, sizeof(*cmd));
   memset(cmd, 0, sizeof(*cmd));
   cmd->type = BACK;
   cmd->cmd = subcmd;
@@ -17,17 +17,34 @@ initsleeplock(struct sleeplock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->pid = 0;
+  lk->lc = lockclass(name, 1);
+  lk->tacquire = 0;
 }
 
 void
 acquiresleep(struct sleeplock *lk)
 {
+  uint t0, wait, pcs[10];
+
   acquire(&lk->lk);
-  while (lk->locked) {
-    sleep(lk, &lk->lk);
+  wait = 0;
+  if(lk->locked){
+    t0 = rdtsc();
+    while (lk->locked) {
+      sleep(lk, &lk->lk);
+    }
+    wait = rdtsc() - t0;
   }
   lk->locked = 1;
   lk->pid = myproc()->pid;
+  lk->tacquire = 0;
+  if(lockstating && lk->lc){
+    pcs[0] = 0;
+    if(wait)
+      getcallerpcs(&lk, pcs);
+    lockacquired(lk->lc, wait, pcs[0]);
+    lk->tacquire = rdtsc();
+  }
   release(&lk->lk);
 }
 
@@ -35,6 +52,8 @@ void
 releasesleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
+  if(lk->tacquire)
+    lockreleased(lk->lc, rdtsc() - lk->tacquire);
   lk->locked = 0;
   lk->pid = 0;
   wakeup(lk);
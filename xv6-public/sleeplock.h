@@ -6,5 +6,9 @@ struct sleeplock {
   // For debugging:
   char *name;        // Name of lock.
   int pid;           // Process holding lock
+
+  // For lockstat:
+  struct lockclass *lc; // Statistics of the locks with this name.
+  uint tacquire;     // rdtsc() when acquired, 0 if not timed.
 };
 
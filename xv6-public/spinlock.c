@@ -8,13 +8,178 @@
 #include "mmu.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "lockstat.h"
+
+// Statistics of a class of locks: all the locks initialized with
+// the same name. Locks of one class can be held on several CPUs at
+// once, so the counters are updated atomically; the maxima and the
+// call sites may lose a racing update. That costs two rdtsc and
+// atomic adds on a line shared by every CPU on each acquisition, so
+// classes are only counted while lockstating is set, by lockstat().
+// Each lock's own contention counters are always kept.
+struct lockclass {
+  struct lockstat st;
+  uint wait[2];       // cycles waiting, low and high words
+  uint hold[2];       // cycles held, low and high words
+};
+
+struct lockclass lockclasses[NLOCKCLASS];
+int lockstating;
+
+// Protects the allocation of classes. It is a bare xchg lock,
+// not a spinlock: initlock() runs before mycpu() works.
+static uint classlock;
+
+static uint
+lockclasses_acquire(void)
+{
+  uint eflags;
+
+  eflags = readeflags();
+  cli();
+  while(xchg(&classlock, 1) != 0)
+    pause();
+  return eflags;
+}
+
+static void
+lockclasses_release(uint eflags)
+{
+  xchg(&classlock, 0);
+  if(eflags & FL_IF)
+    sti();
+}
+
+// Return the class of locks named name, creating it if needed,
+// or 0 if there are too many classes.
+struct lockclass*
+lockclass(char *name, int sleep)
+{
+  struct lockclass *lc, *free;
+  uint eflags;
+
+  eflags = lockclasses_acquire();
+  free = 0;
+  for(lc = lockclasses; lc < &lockclasses[NLOCKCLASS]; lc++){
+    if(lc->st.name[0] == 0){
+      if(free == 0)
+        free = lc;
+      continue;
+    }
+    if(lc->st.sleep == sleep &&
+       strncmp(lc->st.name, name, sizeof(lc->st.name)) == 0)
+      goto found;
+  }
+  if((lc = free) != 0){
+    safestrcpy(lc->st.name, name, sizeof(lc->st.name));
+    lc->st.sleep = sleep;
+  }
+found:
+  lockclasses_release(eflags);
+  return lc;
+}
+
+// Add n cycles to the 64-bit counter c.
+static void
+addcycles(uint *c, uint n)
+{
+  uint old;
+
+  old = fetchadd(&c[0], n);
+  if(old + n < old)
+    fetchadd(&c[1], 1);
+}
+
+// Count an acquisition of a lock of class lc that waited wait
+// cycles; a contended one is charged to the call site pc.
+void
+lockacquired(struct lockclass *lc, uint wait, uint pc)
+{
+  struct lockstat *st = &lc->st;
+  int i, min;
+
+  fetchadd(&st->nacquire, 1);
+  if(wait == 0)
+    return;
+  fetchadd(&st->ncontend, 1);
+  addcycles(lc->wait, wait);
+  if(wait > st->maxwait)
+    st->maxwait = wait;
+
+  // Keep the most frequent sites: a new one replaces the least
+  // frequent.
+  min = 0;
+  for(i = 0; i < NLOCKSITE; i++){
+    if(st->sitepc[i] == pc){
+      fetchadd(&st->sitecount[i], 1);
+      return;
+    }
+    if(st->sitecount[i] < st->sitecount[min])
+      min = i;
+  }
+  st->sitepc[min] = pc;
+  st->sitecount[min] = 1;
+}
+
+// Count hold cycles of holding a lock of class lc.
+void
+lockreleased(struct lockclass *lc, uint hold)
+{
+  addcycles(lc->hold, hold);
+  if(hold > lc->st.maxhold)
+    lc->st.maxhold = hold;
+}
+
+// Copy the statistics of up to n lock classes to st. flags may
+// clear them afterwards (LS_RESET) and start (LS_ON) or stop
+// (LS_OFF) gathering them. Returns the number copied.
+int
+lockstat(struct lockstat *st, int n, int flags)
+{
+  struct lockclass *lc;
+  char name[16];
+  uint eflags;
+  int i, issleep;
+
+  eflags = lockclasses_acquire();
+  i = 0;
+  for(lc = lockclasses; lc < &lockclasses[NLOCKCLASS]; lc++){
+    if(lc->st.name[0] == 0)
+      continue;
+    if(i < n){
+      st[i] = lc->st;
+      st[i].waitk = lc->wait[1] << 22 | lc->wait[0] >> 10;
+      st[i].holdk = lc->hold[1] << 22 | lc->hold[0] >> 10;
+      i++;
+    }
+    if(flags & LS_RESET){
+      memmove(name, lc->st.name, sizeof(name));
+      issleep = lc->st.sleep;
+      memset(lc, 0, sizeof(*lc));
+      memmove(lc->st.name, name, sizeof(name));
+      lc->st.sleep = issleep;
+    }
+  }
+  if(flags & LS_ON)
+    lockstating = 1;
+  if(flags & LS_OFF)
+    lockstating = 0;
+  lockclasses_release(eflags);
+  return i;
+}
 
 void
 initlock(struct spinlock *lk, char *name)
 {
   lk->name = name;
-  lk->locked = 0;
+  lk->next = 0;
+  lk->owner = 0;
   lk->cpu = 0;
+  lk->nacquire = 0;
+  lk->ncontend = 0;
+  lk->spincycles = 0;
+  lk->lc = lockclass(name, 0);
+  lk->tacquire = 0;
 }
 
 // Acquire the lock.
@@ -24,13 +189,21 @@ initlock(struct spinlock *lk, char *name)
 void
 acquire(struct spinlock *lk)
 {
+  uint ticket, t0, spin;
+
   pushcli(); // disable interrupts to avoid deadlock.
   if(holding(lk))
     panic("acquire");
 
-  // The xchg is atomic.
-  while(xchg(&lk->locked, 1) != 0)
-    ;
+  // The fetchadd is atomic.
+  ticket = fetchadd(&lk->next, 1);
+  spin = 0;
+  if(*(volatile uint*)&lk->owner != ticket){
+    t0 = rdtsc();
+    while(*(volatile uint*)&lk->owner != ticket)
+      pause();
+    spin = rdtsc() - t0;
+  }
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
@@ -40,6 +213,16 @@ acquire(struct spinlock *lk)
   // Record info about lock acquisition for debugging.
   lk->cpu = mycpu();
   getcallerpcs(&lk, lk->pcs);
+  lk->nacquire++;
+  if(spin){
+    lk->ncontend++;
+    lk->spincycles += spin;
+  }
+  lk->tacquire = 0;
+  if(lockstating && lk->lc){
+    lockacquired(lk->lc, spin, lk->pcs[0]);
+    lk->tacquire = rdtsc();
+  }
 }
 
 // Release the lock.
@@ -49,6 +232,8 @@ release(struct spinlock *lk)
   if(!holding(lk))
     panic("release");
 
+  if(lk->tacquire)
+    lockreleased(lk->lc, rdtsc() - lk->tacquire);
   lk->pcs[0] = 0;
   lk->cpu = 0;
 
@@ -59,10 +244,10 @@ release(struct spinlock *lk)
   // stores; __sync_synchronize() tells them both not to.
   __sync_synchronize();
 
-  // Release the lock, equivalent to lk->locked = 0.
-  // This code can't use a C assignment, since it might
-  // not be atomic. A real OS would use C atomics here.
-  asm volatile("movl $0, %0" : "+m" (lk->locked) : );
+  // Release the lock to the next ticket, equivalent to
+  // lk->owner++. Only the holder writes owner, so the increment
+  // needs no lock prefix. A real OS would use C atomics here.
+  asm volatile("incl %0" : "+m" (lk->owner) : );
 
   popcli();
 }
@@ -91,7 +276,7 @@ holding(struct spinlock *lock)
 {
   int r;
   pushcli();
-  r = lock->locked && lock->cpu == mycpu();
+  r = lock->owner != lock->next && lock->cpu == mycpu();
   popcli();
   return r;
 }
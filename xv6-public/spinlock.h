@@ -1,11 +1,23 @@
-// Mutual exclusion lock.
+// Mutual exclusion lock: a ticket lock. Each CPU takes the next
+// ticket and waits until owner reaches it, so the lock is handed
+// out in arrival order and waiters only read the shared line.
 struct spinlock {
-  uint locked;       // Is the lock held?
+  uint next;         // Next ticket to hand out.
+  uint owner;        // Ticket now holding the lock.
 
   // For debugging:
   char *name;        // Name of lock.
   struct cpu *cpu;   // The cpu holding the lock.
   uint pcs[10];      // The call stack (an array of program counters)
                      // that locked the lock.
+
+  // Contention counters, updated with the lock held.
+  uint nacquire;     // Acquisitions.
+  uint ncontend;     // Acquisitions that had to wait.
+  uint spincycles;   // Cycles spent waiting, low 32 bits.
+
+  // For lockstat:
+  struct lockclass *lc; // Statistics of the locks with this name.
+  uint tacquire;     // rdtsc() when acquired, 0 if not timed.
 };
 
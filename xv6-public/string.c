@@ -19,6 +19,10 @@ memcmp(const void *v1, const void *v2, uint n)
 
   s1 = v1;
   s2 = v2;
+  // A long at a time up to the first difference; x86 doesn't mind
+  // unaligned loads.
+  while(n >= 4 && *(uint*)s1 == *(uint*)s2)
+    n -= 4, s1 += 4, s2 += 4;
   while(n-- > 0){
     if(*s1 != *s2)
       return *s1 - *s2;
@@ -37,13 +41,29 @@ memmove(void *dst, const void *src, uint n)
   s = src;
   d = dst;
   if(s < d && s + n > d){
+    // dst overlaps the end of src: copy downwards.
     s += n;
     d += n;
+    if(((uint)s - (uint)d) % 4 == 0){
+      while((uint)d % 4 != 0 && n > 0)
+        *--d = *--s, n--;
+      // Not rep movs with the direction flag set: an interrupt
+      // taken meanwhile would run with it set too.
+      for(; n >= 4; n -= 4){
+        s -= 4;
+        d -= 4;
+        *(uint*)d = *(const uint*)s;
+      }
+    }
     while(n-- > 0)
       *--d = *--s;
+  } else if(((uint)s - (uint)d) % 4 == 0){
+    while((uint)d % 4 != 0 && n > 0)
+      *d++ = *s++, n--;
+    movsl(d, s, n / 4);
+    movsb(d + (n & ~3), s + (n & ~3), n % 4);
   } else
-    while(n-- > 0)
-      *d++ = *s++;
+    movsb(d, s, n);
 
   return dst;
 }
@@ -71,10 +91,25 @@ strncpy(char *s, const char *t, int n)
   char *os;
 
   os = s;
-  while(n-- > 0 && (*s++ = *t++) != 0)
-    ;
-  while(n-- > 0)
-    *s++ = 0;
+  while(n > 0 && (uint)t % 4 != 0){
+    n--;
+    if((*s++ = *t++) == 0)
+      goto pad;
+  }
+  // A long at a time while it holds no NUL. t is aligned, so a
+  // long never crosses into a page after the string.
+  while(n >= 4 && !HASZERO(*(uint*)t)){
+    *(uint*)s = *(uint*)t;
+    n -= 4, s += 4, t += 4;
+  }
+  while(n > 0){
+    n--;
+    if((*s++ = *t++) == 0)
+      break;
+  }
+pad:
+  if(n > 0)
+    memset(s, 0, n);
   return os;
 }
 
@@ -0,0 +1,60 @@
+// System call benchmark: cycles per null system call (getpid)
+// entered with sysenter, as the usys.S stubs do, and with the
+// int $T_SYSCALL trap gate they used before, against the library
+// getpid(), which reads the VPROC page.
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+#include "syscall.h"
+#include "traps.h"
+
+#define NCALL 100000
+
+int intgetpid(void)
+{
+	int pid;
+
+	asm volatile("pushl $0; int %2; addl $4, %%esp"
+				 : "=a"(pid)
+				 : "a"(SYS_getpid), "i"(T_SYSCALL)
+				 : "memory", "cc");
+	return pid;
+}
+
+int sysentergetpid(void)
+{
+	int pid;
+
+	asm volatile("movl %%esp, %%ecx; movl $1f, %%edx; sysenter; 1:"
+				 : "=a"(pid)
+				 : "a"(SYS_getpid)
+				 : "ecx", "edx", "memory", "cc");
+	return pid;
+}
+
+void run(char *what, int (*call)(void))
+{
+	uint t;
+	int pid = getpid();
+
+	t = rdtsc();
+	for (int i = 0; i < NCALL; i++)
+	{
+		if (call() != pid)
+		{
+			printf(1, "sysbench: %s: wrong pid\n", what);
+			exit();
+		}
+	}
+	t = rdtsc() - t;
+	printf(1, "%s: %d cycles/call\n", what, t / NCALL);
+}
+
+int main(int argc, char **argv)
+{
+	run("int $T_SYSCALL", intgetpid);
+	run("sysenter", sysentergetpid);
+	run("VPROC page", getpid);
+	exit();
+}
@@ -6,6 +6,7 @@
 #include "proc.h"
 #include "x86.h"
 #include "syscall.h"
+#include "trace.h"
 
 // User code makes a system call with INT T_SYSCALL.
 // System call number in %eax.
@@ -59,13 +60,57 @@ int
 argptr(int n, char **pp, int size)
 {
   int i;
-  struct proc *curproc = myproc();
  
   if(argint(n, &i) < 0)
     return -1;
-  if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
+  return fetchptr(i, pp, size);
+}
+
+// As argptr, for a block the kernel will write.
+int
+argwptr(int n, char **pp, int size)
+{
+  int i;
+
+  if(argint(n, &i) < 0)
+    return -1;
+  return fetchwptr(i, pp, size);
+}
+
+// Check that the size bytes at addr lie within the current process
+// and set *pp to point at them.
+int
+fetchptr(uint addr, char **pp, int size)
+{
+  uint a;
+  struct proc *curproc = myproc();
+
+  if(size < 0 || addr >= curproc->sz || addr+size > curproc->sz)
+    return -1;
+  // Read in program pages not touched yet: some callers use the
+  // buffer while holding a spinlock, where a page fault can't sleep.
+  for(a = PGROUNDDOWN(addr); a < addr+size; a += PGSIZE)
+    execfault(curproc, a);
+  *pp = (char*)addr;
+  return 0;
+}
+
+// As fetchptr, for a block the kernel will write. Each page must be
+// mapped writable: with CR0.WP set, a kernel write to read-only
+// text, or to the stack guard page, faults.
+int
+fetchwptr(uint addr, char **pp, int size)
+{
+  pte_t *pte;
+  uint a;
+
+  if(fetchptr(addr, pp, size) < 0)
     return -1;
-  *pp = (char*)i;
+  for(a = PGROUNDDOWN(addr); a < addr+size; a += PGSIZE){
+    pte = walkpgdir(myproc()->pgdir, (char*)a, 0);
+    if(pte == 0 || (*pte & (PTE_P|PTE_W|PTE_U)) != (PTE_P|PTE_W|PTE_U))
+      return -1;
+  }
   return 0;
 }
 
@@ -109,6 +154,16 @@ extern int sys_ps(void); //written by SeungJaeOh
 extern int sys_mmap(void); //written by SeungJaeOh
 extern int sys_munmap(void); //written by SeungJaeOh
 extern int sys_freemem(void); //written by SeungJaeOh
+extern int sys_faultaround(void);
+extern int sys_msync(void);
+extern int sys_madvise(void);
+extern int sys_lockstat(void);
+extern int sys_profctl(void);
+extern int sys_profread(void);
+extern int sys_tracectl(void);
+extern int sys_traceread(void);
+extern int sys_ringsetup(void);
+extern int sys_ringenter(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -137,18 +192,40 @@ static int (*syscalls[])(void) = {
 [SYS_ps] sys_ps, //written by SeungJaeOh
 [SYS_mmap] sys_mmap, //written by SeungJaeOh
 [SYS_munmap] sys_munmap, //written by SeungJaeOh
-[SYS_freemem] sys_freemem //written by SeungJaeOh
+[SYS_freemem] sys_freemem, //written by SeungJaeOh
+[SYS_faultaround] sys_faultaround,
+[SYS_msync] sys_msync,
+[SYS_madvise] sys_madvise,
+[SYS_lockstat] sys_lockstat,
+[SYS_profctl] sys_profctl,
+[SYS_profread] sys_profread,
+[SYS_tracectl] sys_tracectl,
+[SYS_traceread] sys_traceread,
+[SYS_ringsetup] sys_ringsetup,
+[SYS_ringenter] sys_ringenter,
 };
 
 void
 syscall(void)
 {
-  int num;
+  int num, a[3];
+  uint t0;
   struct proc *curproc = myproc();
 
   num = curproc->tf->eax;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
+    t0 = 0;
+    if(tracing){
+      a[0] = a[1] = a[2] = 0;
+      argint(0, &a[0]);
+      argint(1, &a[1]);
+      argint(2, &a[2]);
+      tracerec(TR_SYSENTER, num, a[0], a[1], a[2], 0, 0);
+      t0 = rdtsc();
+    }
     curproc->tf->eax = syscalls[num]();
+    if(tracing && t0)
+      tracerec(TR_SYSEXIT, num, 0, 0, 0, curproc->tf->eax, rdtsc() - t0);
   } else {
     cprintf("%d %s: unknown sys call %d\n",
             curproc->pid, curproc->name, num);
@@ -25,4 +25,16 @@
 #define SYS_ps 24 //written by SeungJaeOh
 #define SYS_mmap 25 //written by SeungJaeOh
 #define SYS_munmap 26 //written by SeungJaeOh
-#define SYS_freemem 27 //written by SeungJaeOh
\ No newline at end of file
+#define SYS_freemem 27 //written by SeungJaeOh
+#define SYS_faultaround 28
+#define SYS_msync 29
+#define SYS_madvise 30
+#define SYS_lockstat 31
+#define SYS_profctl 32
+#define SYS_profread 33
+#define SYS_tracectl 34
+#define SYS_traceread 35
+#define SYS_ringsetup 36
+#define SYS_ringenter 37
+
+#define NSYSCALL (SYS_ringenter + 1)  // keep after the last call
@@ -15,6 +15,8 @@
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "memlayout.h"
+#include "ring.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
@@ -73,7 +75,7 @@ sys_read(void)
   int n;
   char *p;
 
-  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argptr(1, &p, n) < 0)
+  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argwptr(1, &p, n) < 0)
     return -1;
   return fileread(f, p, n);
 }
@@ -109,7 +111,7 @@ sys_fstat(void)
   struct file *f;
   struct stat *st;
 
-  if(argfd(0, 0, &f) < 0 || argptr(1, (void*)&st, sizeof(*st)) < 0)
+  if(argfd(0, 0, &f) < 0 || argwptr(1, (void*)&st, sizeof(*st)) < 0)
     return -1;
   return filestat(f, st);
 }
@@ -282,17 +284,14 @@ create(char *path, short type, short major, short minor)
   return ip;
 }
 
-int
-sys_open(void)
+// Open path and return a new file descriptor for it.
+static int
+openpath(char *path, int omode)
 {
-  char *path;
-  int fd, omode;
+  int fd;
   struct file *f;
   struct inode *ip;
 
-  if(argstr(0, &path) < 0 || argint(1, &omode) < 0)
-    return -1;
-
   begin_op();
 
   if(omode & O_CREATE){
@@ -332,6 +331,17 @@ sys_open(void)
   return fd;
 }
 
+int
+sys_open(void)
+{
+  char *path;
+  int omode;
+
+  if(argstr(0, &path) < 0 || argint(1, &omode) < 0)
+    return -1;
+  return openpath(path, omode);
+}
+
 int
 sys_mkdir(void)
 {
@@ -426,7 +436,7 @@ sys_pipe(void)
   struct file *rf, *wf;
   int fd0, fd1;
 
-  if(argptr(0, (void*)&fd, 2*sizeof(fd[0])) < 0)
+  if(argwptr(0, (void*)&fd, 2*sizeof(fd[0])) < 0)
     return -1;
   if(pipealloc(&rf, &wf) < 0)
     return -1;
@@ -442,3 +452,101 @@ sys_pipe(void)
   fd[1] = fd1;
   return 0;
 }
+
+// Give the current process a submission ring, mapped at VRING.
+// Returns its address, or 0 on failure.
+int
+sys_ringsetup(void)
+{
+  struct proc *curproc = myproc();
+  struct ring *r;
+
+  if(curproc->ring)
+    return VRING;
+  if((r = (struct ring*)kalloc()) == 0)
+    return 0;
+  memset(r, 0, PGSIZE);
+  if(mapupage(curproc->pgdir, VRING, r, PTE_W|PTE_U) < 0){
+    kfree((char*)r);
+    return 0;
+  }
+  curproc->ring = r;
+  return VRING;
+}
+
+// Carry out one submission, with the checks of the system call
+// it stands for.
+static int
+ringop(struct sqe *e)
+{
+  struct file *f;
+  char *p;
+  uint off;
+
+  if(e->op == RING_OPEN){
+    if(fetchstr(e->addr, &p) < 0)
+      return -1;
+    return openpath(p, e->len);
+  }
+  if(e->fd < 0 || e->fd >= NOFILE || (f = myproc()->ofile[e->fd]) == 0)
+    return -1;
+  switch(e->op){
+  case RING_READ:
+    if(fetchwptr(e->addr, &p, e->len) < 0)
+      return -1;
+    return fileread(f, p, e->len);
+  case RING_WRITE:
+    if(fetchptr(e->addr, &p, e->len) < 0)
+      return -1;
+    return filewrite(f, p, e->len);
+  case RING_CLOSE:
+    myproc()->ofile[e->fd] = 0;
+    fileclose(f);
+    return 0;
+  case RING_FSYNC:
+    // Writes are on disk once the log commits; only pages written
+    // through shared mappings can still be dirty.
+    if(f->type == FD_INODE){
+      mmapharvest();
+      for(off = 0; off < f->ip->size; off += PGSIZE)
+        pcsync(f->ip, off);
+    }
+    return 0;
+  }
+  return -1;
+}
+
+// Carry out the operations queued in the current process's ring,
+// in order, as long as there is room for their completions: one
+// trap for the whole batch. Returns how many were done.
+int
+sys_ringenter(void)
+{
+  struct proc *curproc = myproc();
+  struct ring *r = curproc->ring;
+  struct sqe e;
+  struct cqe *c;
+  uint head, tail;
+  int n;
+
+  if(r == 0)
+    return -1;
+  head = r->sqhead;
+  for(n = 0; !curproc->killed; n++){
+    tail = *(volatile uint*)&r->sqtail;
+    if(head == tail || tail - head > NRINGENT)
+      break;
+    if(r->cqtail - *(volatile uint*)&r->cqhead >= NRINGENT)
+      break;
+    __sync_synchronize();
+    // A copy, since the process can change the ring under us.
+    e = r->sq[head % NRINGENT];
+    c = &r->cq[r->cqtail % NRINGENT];
+    c->data = e.data;
+    c->res = ringop(&e);
+    __sync_synchronize();
+    r->cqtail++;
+    r->sqhead = ++head;
+  }
+  return n;
+}
@@ -6,6 +6,9 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "lockstat.h"
+#include "profile.h"
+#include "trace.h"
 
 int
 sys_fork(void)
@@ -144,12 +147,139 @@ sys_munmap(void){
   return munmap(addr);
 }
 
+int
+sys_msync(void){
+  int addr, length;
+
+  if(argint(0, &addr) < 0 || argint(1, &length) < 0)
+    return -1;
+  return msync(addr, length);
+}
+
+int
+sys_madvise(void){
+  int addr, length, advice;
+
+  if(argint(0, &addr) < 0 || argint(1, &length) < 0 || argint(2, &advice) < 0)
+    return -1;
+  return madvise(addr, length, advice);
+}
+
 int
 sys_freemem(void){
   
   return freemem();;
 }
 
+// Set the mmap fault-around window to n pages, if n > 0.
+// Returns the previous window.
+int
+sys_faultaround(void){
+  extern int faultaround;
+  int n, old;
+
+  if(argint(0, &n) < 0 || n > MAXFAULTAROUND)
+    return -1;
+  old = faultaround;
+  if(n > 0)
+    faultaround = n;
+  return old;
+}
+
+// copy the statistics of up to n lock classes to st, then act
+// on the LS_ flags; return how many there are.
+int
+sys_lockstat(void)
+{
+  struct lockstat *st, *buf;
+  int n, flags;
+
+  if(argint(1, &n) < 0 || argint(2, &flags) < 0 || n < 0)
+    return -1;
+  if(n > PGSIZE / sizeof(*st))
+    n = PGSIZE / sizeof(*st);
+  if(argwptr(0, (void*)&st, n*sizeof(*st)) < 0)
+    return -1;
+  // Gathered with interrupts off, where touching user memory
+  // could fault, so go through a kernel page.
+  if((buf = (struct lockstat*)kalloc()) == 0)
+    return -1;
+  n = lockstat(buf, n, flags);
+  memmove(st, buf, n*sizeof(*st));
+  kfree((char*)buf);
+  return n;
+}
+
+// turn the profiler on (1) or off (0); return how many samples
+// were dropped.
+int
+sys_profctl(void)
+{
+  int on;
+
+  if(argint(0, &on) < 0)
+    return -1;
+  return profctl(on != 0);
+}
+
+// move up to n profiler samples to buf; return how many.
+int
+sys_profread(void)
+{
+  struct profsample *buf, *kbuf;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -1;
+  if(n > PGSIZE / sizeof(*buf))
+    n = PGSIZE / sizeof(*buf);
+  if(argwptr(0, (void*)&buf, n*sizeof(*buf)) < 0)
+    return -1;
+  // Taken out under a spinlock, where touching user memory could
+  // fault, so go through a kernel page.
+  if((kbuf = (struct profsample*)kalloc()) == 0)
+    return -1;
+  n = profread(kbuf, n);
+  memmove(buf, kbuf, n*sizeof(*buf));
+  kfree((char*)kbuf);
+  return n;
+}
+
+// turn event tracing on (1) or off (0); return how many events
+// were dropped.
+int
+sys_tracectl(void)
+{
+  int on;
+
+  if(argint(0, &on) < 0)
+    return -1;
+  return tracectl(on != 0);
+}
+
+// move up to n trace events to buf; return how many.
+int
+sys_traceread(void)
+{
+  struct traceev *buf, *kbuf;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -1;
+  if(n > PGSIZE / sizeof(*buf))
+    n = PGSIZE / sizeof(*buf);
+  if(argwptr(0, (void*)&buf, n*sizeof(*buf)) < 0)
+    return -1;
+  // Taken out under a spinlock, where touching user memory could
+  // fault, so go through a kernel page.
+  if((kbuf = (struct traceev*)kalloc()) == 0)
+    return -1;
+  n = traceread(kbuf, n);
+  memmove(buf, kbuf, n*sizeof(*buf));
+  kfree((char*)kbuf);
+  return n;
+}
+
 // return how many clock tick interrupts have occurred
 // since start.
 int
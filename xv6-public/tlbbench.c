@@ -0,0 +1,47 @@
+// TLB benchmark: random reads over a large anonymous MAP_POPULATE
+// mapping, backed by 4KB pages and then by 4MB pages (MAP_HUGE).
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+#include "param.h"
+#include "mmu.h"
+
+#define SIZE    (4 * LARGEPGSIZE)
+#define NACCESS (1 << 20)
+
+void run(char *what, int flags)
+{
+	uint seed = 1, t, sum = 0;
+	int free0;
+	int *p;
+
+	free0 = freemem();
+	if ((p = (int *)mmap(0, SIZE, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_POPULATE | flags, -1, 0)) == 0)
+	{
+		printf(1, "tlbbench: mmap failed\n");
+		exit();
+	}
+	for (int i = 0; i < SIZE / PGSIZE; i++)
+		p[i * PGSIZE / sizeof(int)] = i;
+
+	t = rdtsc();
+	for (int i = 0; i < NACCESS; i++)
+	{
+		// a page picked at random each time, so almost every
+		// access misses a TLB of 4KB entries
+		seed = seed * 1103515245 + 12345;
+		sum += p[(seed >> 8) % (SIZE / PGSIZE) * (PGSIZE / sizeof(int))];
+	}
+	t = rdtsc() - t;
+	printf(1, "%s: %d cycles/access, %d small pages used (sum %d)\n",
+		   what, t / NACCESS, free0 - freemem(), sum);
+	munmap((uint)p);
+}
+
+int main(int argc, char **argv)
+{
+	run("4KB pages", 0);
+	run("4MB pages", MAP_HUGE);
+	exit();
+}
@@ -0,0 +1,185 @@
+// trace [-m mincycles] [ticks]: turn event tracing on for ticks
+// clock ticks (default 100), printing each event as it is read,
+// then print per system call counts and times. With -m only timed
+// events that took at least mincycles are printed, which is a
+// quick way to find latency outliers. Run a workload alongside,
+// e.g. "trace 200 &". Events of the tracer itself are skipped.
+// Events come out a CPU's ring at a time, in order within a CPU.
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "syscall.h"
+#include "trace.h"
+
+#define NEV 64
+
+char *names[NSYSCALL] = {
+	[SYS_fork] "fork",
+	[SYS_exit] "exit",
+	[SYS_wait] "wait",
+	[SYS_pipe] "pipe",
+	[SYS_read] "read",
+	[SYS_kill] "kill",
+	[SYS_exec] "exec",
+	[SYS_fstat] "fstat",
+	[SYS_chdir] "chdir",
+	[SYS_dup] "dup",
+	[SYS_getpid] "getpid",
+	[SYS_sbrk] "sbrk",
+	[SYS_sleep] "sleep",
+	[SYS_uptime] "uptime",
+	[SYS_open] "open",
+	[SYS_write] "write",
+	[SYS_mknod] "mknod",
+	[SYS_unlink] "unlink",
+	[SYS_link] "link",
+	[SYS_mkdir] "mkdir",
+	[SYS_close] "close",
+	[SYS_getnice] "getnice",
+	[SYS_setnice] "setnice",
+	[SYS_ps] "ps",
+	[SYS_mmap] "mmap",
+	[SYS_munmap] "munmap",
+	[SYS_freemem] "freemem",
+	[SYS_faultaround] "faultaround",
+	[SYS_msync] "msync",
+	[SYS_madvise] "madvise",
+	[SYS_lockstat] "lockstat",
+	[SYS_profctl] "profctl",
+	[SYS_profread] "profread",
+	[SYS_tracectl] "tracectl",
+	[SYS_traceread] "traceread",
+	[SYS_ringsetup] "ringsetup",
+	[SYS_ringenter] "ringenter",
+};
+
+struct traceev ev[NEV];
+struct traceev enter[NPROC]; // last entry of each pid, by pid % NPROC
+uint count[NSYSCALL];
+uint totalk[NSYSCALL];       // in units of 1024 cycles
+uint maxc[NSYSCALL];
+uint mincycles;
+int self;
+
+char *name(uint num)
+{
+	if (num < NSYSCALL && names[num])
+		return names[num];
+	return "?";
+}
+
+void print(struct traceev *e)
+{
+	struct traceev *s;
+
+	if (e->type != TR_SYSENTER && e->cycles < mincycles)
+		return;
+	printf(1, "%d: cpu %d pid %d ", e->tsc, e->cpu, e->pid);
+	switch (e->type)
+	{
+	case TR_SYSENTER:
+		printf(1, "enter %s(%x, %x, %x)\n", name(e->a[0]), e->a[1], e->a[2], e->a[3]);
+		break;
+	case TR_SYSEXIT:
+		s = &enter[e->pid % NPROC];
+		if (s->pid == e->pid && s->a[0] == e->a[0])
+			printf(1, "%s(%x, %x, %x) = %d, %d cycles\n", name(e->a[0]),
+				   s->a[1], s->a[2], s->a[3], e->ret, e->cycles);
+		else
+			printf(1, "%s = %d, %d cycles\n", name(e->a[0]), e->ret, e->cycles);
+		break;
+	case TR_SWITCH:
+		printf(1, "switch to pid %d\n", e->a[0]);
+		break;
+	case TR_PGFAULT:
+		printf(1, "page fault at %x err %x eip %x %s, %d cycles\n",
+			   e->a[0], e->a[1], e->a[2], e->ret == 0 ? "handled" : "bad", e->cycles);
+		break;
+	case TR_DISK:
+		printf(1, "disk %s block %d, %d cycles\n", e->a[1] ? "write" : "read", e->a[0], e->cycles);
+		break;
+	default:
+		printf(1, "event %d\n", e->type);
+	}
+}
+
+void record(struct traceev *e)
+{
+	uint num = e->a[0];
+
+	if (e->type == TR_SYSENTER)
+	{
+		// Kept for the exit, which is printed alone with -m.
+		enter[e->pid % NPROC] = *e;
+		if (mincycles > 0)
+			return;
+	}
+	if (e->type == TR_SYSEXIT && num < NSYSCALL)
+	{
+		count[num]++;
+		totalk[num] += e->cycles >> 10;
+		if (e->cycles > maxc[num])
+			maxc[num] = e->cycles;
+	}
+	print(e);
+}
+
+// Read and print everything buffered so far.
+void drain()
+{
+	int n;
+
+	while ((n = traceread(ev, NEV)) > 0)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			if (ev[i].pid != self)
+				record(&ev[i]);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int ticks = 100, dropped, t0;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+			mincycles = atoi(argv[++i]);
+		else if (argv[i][0] >= '0' && argv[i][0] <= '9')
+			ticks = atoi(argv[i]);
+		else
+		{
+			printf(2, "usage: trace [-m mincycles] [ticks]\n");
+			exit();
+		}
+	}
+	self = getpid();
+
+	tracectl(1);
+	t0 = uptime();
+	while (uptime() - t0 < ticks)
+	{
+		sleep(1);
+		drain();
+	}
+	dropped = tracectl(0);
+	drain();
+
+	printf(1, "\nsyscall       count  avg kcycles  max cycles\n");
+	for (i = 0; i < NSYSCALL; i++)
+	{
+		if (count[i] == 0)
+			continue;
+		printf(1, "%s", name(i));
+		for (int k = strlen(name(i)); k < 12; k++)
+			printf(1, " ");
+		printf(1, "  %d  %d  %d\n", count[i], totalk[i] / count[i], maxc[i]);
+	}
+	if (dropped)
+		printf(1, "%d events dropped\n", dropped);
+	exit();
+}
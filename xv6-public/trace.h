@@ -0,0 +1,16 @@
+// A trace event, read by the traceread system call.
+#define TR_SYSENTER 1    // a: syscall number and first three args
+#define TR_SYSEXIT  2    // a[0]: syscall number; ret, cycles
+#define TR_SWITCH   3    // scheduler switched to pid
+#define TR_PGFAULT  4    // a: address, error code, eip; ret 0 if handled
+#define TR_DISK     5    // a: block, 1 if a write; cycles on the disk
+
+struct traceev {
+  uint tsc;              // rdtsc() when recorded
+  ushort type;           // TR_*
+  ushort cpu;
+  int pid;               // current process, 0 if none
+  uint a[4];
+  int ret;
+  uint cycles;           // duration, where the event has one
+};
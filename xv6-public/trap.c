@@ -7,6 +7,7 @@
 #include "x86.h"
 #include "traps.h"
 #include "spinlock.h"
+#include "trace.h"
 
 // Interrupt descriptor table (shared by all CPUs).
 struct gatedesc idt[256];
@@ -14,10 +15,6 @@ extern uint vectors[]; // in vectors.S: array of 256 entry pointers
 struct spinlock tickslock;
 uint ticks;
 
-// written by SeungJaeOh
-// extern struct mmap_area;
-extern struct mmap_area mmap_area_array[NMMAPAREA];
-
 void tvinit(void)
 {
   int i;
@@ -37,6 +34,18 @@ void idtinit(void)
 // PAGEBREAK: 41
 void trap(struct trapframe *tf)
 {
+  uint addr, t0;
+  int r;
+
+  // sysenter on a CPU without it: do what it would have done.
+  if (tf->trapno == T_ILLOP && (tf->cs & 3) == DPL_USER && myproc() != 0 &&
+      tf->eip + 2 <= myproc()->sz && *(ushort *)tf->eip == 0x340f)
+  {
+    tf->eip = tf->edx;
+    tf->esp = tf->ecx;
+    tf->trapno = T_SYSCALL;
+  }
+
   if (tf->trapno == T_SYSCALL)
   {
     if (myproc()->killed)
@@ -55,9 +64,14 @@ void trap(struct trapframe *tf)
     {
       acquire(&tickslock);
       ticks++;
+      vdatatick();
       wakeup(&ticks);
       release(&tickslock);
     }
+    if (profiling)
+    {
+      profsample(tf);
+    }
     lapiceoi();
     break;
   case T_IRQ0 + IRQ_IDE:
@@ -82,74 +96,22 @@ void trap(struct trapframe *tf)
     lapiceoi();
     break;
   case T_PGFLT:
-    uint addr = rcr2();
-    if (addr < MMAPBASE || addr > KERNBASE)
-    {
-      return;
-    }
-    // if 0 means read and 1 means write
-    int write_access = tf->err & 2;
-    for (int i = 0; i < NMMAPAREA; ++i)
+    // demand page an mmap area or a program segment; anything
+    // else, or a write to a read only area, is treated like any
+    // other bad trap
+    if (myproc() != 0)
     {
-
-      // check if process that cause page fault in mmap_area_array
-      if (mmap_area_array[i].p == myproc() && mmap_area_array[i].addr == addr)
+      addr = rcr2();
+      t0 = rdtsc();
+      r = mmapfault(myproc(), addr, tf->err & 2) == 0 ||
+          execfault(myproc(), addr) == 0;
+      if (tracing)
       {
-        // write error
-        if (write_access && ((mmap_area_array[i].prot & PROT_WRITE) == 0))
-        {
-          // check if page is read onlyF
-          // if read only, process is terminated
-          break;
-        }
-
-        // allocate page according to mmap_area_array
-        struct file *f = mmap_area_array[i].f;
-        int length = mmap_area_array[i].length;
-        int offset = mmap_area_array[i].offset;
-        int flags = mmap_area_array[i].flags;
-        struct proc *curproc = mmap_area_array[i].p;
-        char *mem;
-        // static char buffer[PGSIZE];
-        for (int i = addr; i < addr + length; i += PGSIZE)
-        {
-          // if failed to allocate physical page, return 0
-          // 일단 고려하지 않는다.
-
-          mem = kalloc();
-          if (mem == 0)
-          {
-            return;
-          }
-
-          // set memory as 0
-          if (flags & MAP_ANONYMOUS)
-          {
-            memset(mem, 0, PGSIZE);
-          }
-          // set memory from fd
-          else if(f!=0)
-          {
-            while (offset > 0)
-            {
-              if (offset >= PGSIZE)
-              {
-                fileread(f, mem, PGSIZE);
-                offset -= PGSIZE;
-              }
-              else
-              {
-                fileread(f, mem, offset);
-                offset = 0;
-              }
-            }
-
-            memset(mem, 1, PGSIZE);
-            fileread(f, mem, PGSIZE);
-          }
-          mappages(curproc->pgdir, (void *)i, PGSIZE, V2P(mem), PTE_W | PTE_U);
-        }
-        return;
+        tracerec(TR_PGFAULT, addr, tf->err, tf->eip, 0, r ? 0 : -1, rdtsc() - t0);
+      }
+      if (r)
+      {
+        break;
       }
     }
 
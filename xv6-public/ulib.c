@@ -3,6 +3,8 @@
 #include "fcntl.h"
 #include "user.h"
 #include "x86.h"
+#include "memlayout.h"
+#include "vdata.h"
 
 char*
 strcpy(char *s, const char *t)
@@ -18,6 +20,17 @@ strcpy(char *s, const char *t)
 int
 strcmp(const char *p, const char *q)
 {
+  // A long at a time once both are aligned, while the longs match
+  // and hold no NUL. Aligned longs never cross a page boundary.
+  if((uint)p % 4 == (uint)q % 4){
+    while((uint)p % 4 != 0){
+      if(*p == 0 || *p != *q)
+        return (uchar)*p - (uchar)*q;
+      p++, q++;
+    }
+    while(*(uint*)p == *(uint*)q && !HASZERO(*(uint*)p))
+      p += 4, q += 4;
+  }
   while(*p && *p == *q)
     p++, q++;
   return (uchar)*p - (uchar)*q;
@@ -26,17 +39,26 @@ strcmp(const char *p, const char *q)
 uint
 strlen(const char *s)
 {
-  int n;
+  const char *p;
 
-  for(n = 0; s[n]; n++)
-    ;
-  return n;
+  for(p = s; (uint)p % 4 != 0; p++)
+    if(*p == 0)
+      return p - s;
+  while(!HASZERO(*(uint*)p))
+    p += 4;
+  while(*p)
+    p++;
+  return p - s;
 }
 
 void*
 memset(void *dst, int c, uint n)
 {
-  stosb(dst, c, n);
+  if ((int)dst%4 == 0 && n%4 == 0){
+    c &= 0xFF;
+    stosl(dst, (c<<24)|(c<<16)|(c<<8)|c, n/4);
+  } else
+    stosb(dst, c, n);
   return dst;
 }
 
@@ -95,12 +117,127 @@ atoi(const char *s)
 void*
 memmove(void *vdst, const void *vsrc, int n)
 {
-  char *dst;
-  const char *src;
+  char *d;
+  const char *s;
 
-  dst = vdst;
-  src = vsrc;
-  while(n-- > 0)
-    *dst++ = *src++;
+  if(n <= 0)
+    return vdst;
+  d = vdst;
+  s = vsrc;
+  if(s < d && s + n > d){
+    // dst overlaps the end of src: copy downwards.
+    s += n;
+    d += n;
+    if(((uint)s - (uint)d) % 4 == 0){
+      while((uint)d % 4 != 0 && n > 0)
+        *--d = *--s, n--;
+      // By hand, without the direction flag, as in the kernel.
+      for(; n >= 4; n -= 4){
+        s -= 4;
+        d -= 4;
+        *(uint*)d = *(const uint*)s;
+      }
+    }
+    while(n-- > 0)
+      *--d = *--s;
+  } else if(((uint)s - (uint)d) % 4 == 0){
+    while((uint)d % 4 != 0 && n > 0)
+      *d++ = *s++, n--;
+    movsl(d, s, n / 4);
+    movsb(d + (n & ~3), s + (n & ~3), n % 4);
+  } else
+    movsb(d, s, n);
   return vdst;
 }
+
+int
+memcmp(const void *v1, const void *v2, uint n)
+{
+  const uchar *s1, *s2;
+
+  s1 = v1;
+  s2 = v2;
+  while(n >= 4 && *(uint*)s1 == *(uint*)s2)
+    n -= 4, s1 += 4, s2 += 4;
+  while(n-- > 0){
+    if(*s1 != *s2)
+      return *s1 - *s2;
+    s1++, s2++;
+  }
+  return 0;
+}
+
+// getpid() and uptime() read the pages the kernel maps at VPROC
+// and VDATA instead of making a system call.
+int
+getpid(void)
+{
+  return ((struct vproc*)VPROC)->pid;
+}
+
+int
+uptime(void)
+{
+  return ((volatile struct vdata*)VDATA)->ticks;
+}
+
+// Time since boot in 1/1024ths of a tick: the last tick plus the
+// TSC cycles since then, scaled by the kernel's cycles per tick.
+uint
+fineuptime(void)
+{
+  volatile struct vdata *v = (struct vdata*)VDATA;
+  uint seq, t, tsc, c, f;
+
+  do{
+    seq = v->seq;
+    __sync_synchronize();
+    t = v->ticks;
+    tsc = v->tsc;
+    c = v->tickcycles;
+    __sync_synchronize();
+  } while((seq & 1) || seq != v->seq);
+  f = 0;
+  if(c >= 1024){
+    f = (rdtsc() - tsc) / (c / 1024);
+    if(f > 1023)
+      f = 1023;
+  }
+  return t * 1024 + f;
+}
+
+// Set by printf.c when it buffers output: called with -1 before the
+// process exits, forks or execs, and with fd before fd is closed.
+void (*flushhook)(int);
+
+int
+fork(void)
+{
+  if(flushhook)
+    flushhook(-1);
+  return _fork();
+}
+
+int
+exit(void)
+{
+  if(flushhook)
+    flushhook(-1);
+  _exit();
+}
+
+int
+exec(char *path, char **argv)
+{
+  if(flushhook)
+    flushhook(-1);
+  return _exec(path, argv);
+}
+
+int
+close(int fd)
+{
+  if(flushhook)
+    flushhook(fd);
+  return _close(fd);
+}
@@ -3,88 +3,346 @@
 #include "user.h"
 #include "param.h"
 
-// Memory allocator by Kernighan and Ritchie,
-// The C programming Language, 2nd ed.  Section 8.7.
+// Memory allocator with size classes.
+//
+// A request of up to MAXSMALL bytes, with its header, is rounded up
+// to a power of two class. Each class has its own free list, and a
+// class that runs out carves a page from sbrk() into blocks. Small
+// blocks are never merged.
+//
+// Bigger blocks come from chunks of whole pages and carry boundary
+// tags: the size, with INUSE, in both a header and a footer, so
+// free() finds and merges free neighbours without a search. Each
+// chunk starts with an in-use footer and ends with an in-use
+// header, so merging stops at its ends. A chunk that sbrk() places
+// right after the last one instead extends it. Free big blocks are
+// on doubly linked lists, one per power of two of size.
+//
+// So malloc and free take constant time, except that malloc scans
+// the one bin that may hold blocks both smaller and bigger than it
+// needs.
 
-typedef long Align;
+#define PGSIZE   4096
+#define NCLASS   8                                   // 16..2048 bytes
+#define MINCLASS 16
+#define MAXSMALL (MINCLASS << (NCLASS - 1))
+#define NBIN     32
+#define BIGCHUNK (8 * PGSIZE)  // least sbrk() for big blocks
+#define MINBIG   64            // least worth splitting off
 
-union header {
-  struct {
-    union header *ptr;
-    uint size;
-  } s;
-  Align x;
-};
+#define INUSE    1
+#define SMALL    2
+#define TAGS     7
+
+// Every block starts with a header, 8 bytes to keep alignment.
+// A free block's payload holds its list links.
+typedef struct header {
+  uint size;                   // bytes, including the tags; | INUSE, SMALL
+  uint pad;
+  struct header *next;         // free blocks only
+  struct header *prev;         // free big blocks only
+} Header;
+
+#define HDRSZ     8
+#define FTRSZ     4
+#define FOOTER(h) ((uint*)((char*)(h) + ((h)->size & ~TAGS)) - 1)
+
+static Header *smallfree[NCLASS];
+static Header *bigfree[NBIN];
+static char *bigend;           // epilogue of the last big chunk
+static char *bigtop;           // end of the last big chunk
+
+// Index of the highest bit set in n.
+static int
+ilog2(uint n)
+{
+  int i;
+
+  for(i = 0; n > 1; i++)
+    n >>= 1;
+  return i;
+}
 
-typedef union header Header;
+static void
+unbin(Header *h)
+{
+  if(h->prev)
+    h->prev->next = h->next;
+  else
+    bigfree[ilog2(h->size & ~TAGS)] = h->next;
+  if(h->next)
+    h->next->prev = h->prev;
+}
 
-static Header base;
-static Header *freep;
+// Mark h, of size bytes, free and put it on its bin.
+static void
+insert(Header *h, uint size)
+{
+  Header **bin;
+
+  h->size = size;
+  *FOOTER(h) = size;
+  bin = &bigfree[ilog2(size)];
+  h->prev = 0;
+  h->next = *bin;
+  if(*bin)
+    (*bin)->prev = h;
+  *bin = h;
+}
+
+// Free big block h, merging it with free neighbours.
+static void
+freebig(Header *h)
+{
+  uint size, prevtag;
+  Header *n;
+
+  size = h->size & ~TAGS;
+  prevtag = *((uint*)h - 1);
+  if(!(prevtag & INUSE)){
+    h = (Header*)((char*)h - prevtag);
+    unbin(h);
+    size += prevtag;
+  }
+  n = (Header*)((char*)h + size);
+  if(!(n->size & INUSE)){
+    unbin(n);
+    size += n->size;
+  }
+  insert(h, size);
+}
 
 void
 free(void *ap)
 {
-  Header *bp, *p;
-
-  bp = (Header*)ap - 1;
-  for(p = freep; !(bp > p && bp < p->s.ptr); p = p->s.ptr)
-    if(p >= p->s.ptr && (bp > p || bp < p->s.ptr))
-      break;
-  if(bp + bp->s.size == p->s.ptr){
-    bp->s.size += p->s.ptr->s.size;
-    bp->s.ptr = p->s.ptr->s.ptr;
-  } else
-    bp->s.ptr = p->s.ptr;
-  if(p + p->s.size == bp){
-    p->s.size += bp->s.size;
-    p->s.ptr = bp->s.ptr;
+  Header *h;
+  int c;
+
+  if(ap == 0)
+    return;
+  h = (Header*)((char*)ap - HDRSZ);
+  if(h->size & SMALL){
+    c = ilog2((h->size & ~TAGS) / MINCLASS);
+    h->next = smallfree[c];
+    smallfree[c] = h;
   } else
-    p->s.ptr = bp;
-  freep = p;
+    freebig(h);
 }
 
-static Header*
-morecore(uint nu)
+// Carve a new page into blocks of class c.
+static int
+moresmall(int c)
+{
+  char *p, *e;
+  Header *h;
+  uint size = MINCLASS << c;
+
+  if((p = sbrk(PGSIZE)) == (char*)-1)
+    return -1;
+  // sbrk() may have been left unaligned by someone else.
+  e = p + PGSIZE;
+  p = (char*)(((uint)p + HDRSZ - 1) & ~(HDRSZ - 1));
+  for(; p + size <= e; p += size){
+    h = (Header*)p;
+    h->size = size | SMALL | INUSE;
+    h->next = smallfree[c];
+    smallfree[c] = h;
+  }
+  return 0;
+}
+
+// Get at least size more bytes of big blocks from sbrk().
+static int
+morebig(uint size)
 {
   char *p;
-  Header *hp;
+  uint n;
+  Header *h;
 
-  if(nu < 4096)
-    nu = 4096;
-  p = sbrk(nu * sizeof(Header));
-  if(p == (char*)-1)
-    return 0;
-  hp = (Header*)p;
-  hp->s.size = nu;
-  free((void*)(hp + 1));
-  return freep;
+  n = (size + 2*HDRSZ + PGSIZE - 1) & ~(PGSIZE - 1);
+  // sbrk() takes an int: a bigger n would shrink the heap instead.
+  if(n < size || n > 0x7fffffff)
+    return -1;
+  if(n < BIGCHUNK)
+    n = BIGCHUNK;
+  if((p = sbrk(n)) == (char*)-1)
+    return -1;
+  if(bigtop != 0 && p == bigtop){
+    // Right after the last chunk: the new space starts at its
+    // epilogue and can merge with its last block.
+    h = (Header*)bigend;
+    p += n;
+  } else {
+    h = (Header*)(((uint)p + 2*HDRSZ - 1) & ~(HDRSZ - 1));
+    *((uint*)h - 1) = INUSE;    // prologue
+    p += n;
+  }
+  bigtop = p;
+  bigend = (char*)(((uint)p & ~(HDRSZ - 1)) - HDRSZ);
+  ((Header*)bigend)->size = INUSE;  // epilogue
+  h->size = (bigend - (char*)h) | INUSE;
+  freebig(h);
+  return 0;
+}
+
+static void*
+mallocbig(uint size)
+{
+  Header *h;
+  int b;
+  uint rest;
+
+  for(;;){
+    b = ilog2(size);
+    // Blocks in size's own bin may be too small; in any bigger
+    // bin, the first one will do.
+    for(h = bigfree[b]; h; h = h->next)
+      if(h->size >= size)
+        goto found;
+    for(b++; b < NBIN; b++)
+      if((h = bigfree[b]) != 0)
+        goto found;
+    if(morebig(size) < 0)
+      return 0;
+  }
+
+found:
+  unbin(h);
+  rest = h->size - size;
+  if(rest >= MINBIG){
+    h->size = size;
+    insert((Header*)((char*)h + size), rest);
+  } else
+    size = h->size;
+  h->size = size | INUSE;
+  *FOOTER(h) = size | INUSE;
+  return (char*)h + HDRSZ;
 }
 
 void*
 malloc(uint nbytes)
 {
-  Header *p, *prevp;
-  uint nunits;
+  Header *h;
+  int c;
 
-  nunits = (nbytes + sizeof(Header) - 1)/sizeof(Header) + 1;
-  if((prevp = freep) == 0){
-    base.s.ptr = freep = prevp = &base;
-    base.s.size = 0;
+  if(nbytes > 0x7fffffff)
+    return 0;
+  if(nbytes + HDRSZ <= MAXSMALL){
+    c = 0;
+    while((MINCLASS << c) < nbytes + HDRSZ)
+      c++;
+    if(smallfree[c] == 0 && moresmall(c) < 0)
+      return 0;
+    h = smallfree[c];
+    smallfree[c] = h->next;
+    return (char*)h + HDRSZ;
   }
-  for(p = prevp->s.ptr; ; prevp = p, p = p->s.ptr){
-    if(p->s.size >= nunits){
-      if(p->s.size == nunits)
-        prevp->s.ptr = p->s.ptr;
-      else {
-        p->s.size -= nunits;
-        p += p->s.size;
-        p->s.size = nunits;
-      }
-      freep = prevp;
-      return (void*)(p + 1);
+  return mallocbig((nbytes + HDRSZ + FTRSZ + HDRSZ - 1) & ~(HDRSZ - 1));
+}
+
+// Arenas: a bump pointer through pages from sbrk(), for many small
+// allocations that all die together. Nothing is freed on its own;
+// arenareset() frees everything in the arena at once and keeps one
+// page for reuse, and arenadestroy() frees the arena too. Freed pages
+// go on a spare list for later arenas, since sbrk() can only give
+// memory back from the top.
+
+struct apage {
+  struct apage *next;
+  uint size;                   // bytes, including this header
+};
+
+struct arena {
+  struct apage *pages;         // first is the one holding the arena
+  char *p;                     // next free byte
+  char *end;                   // end of the current page
+};
+
+#define ARENASTART(ar) ((char*)(((uint)((ar) + 1) + 7) & ~7))
+
+static struct apage *sparepages;
+
+// Get a chunk of at least size bytes, spare or from sbrk().
+static struct apage*
+getapage(uint size)
+{
+  struct apage **pp, *a;
+
+  size = (size + PGSIZE - 1) & ~(PGSIZE - 1);
+  for(pp = &sparepages; (a = *pp) != 0; pp = &a->next){
+    if(a->size >= size){
+      *pp = a->next;
+      return a;
     }
-    if(p == freep)
-      if((p = morecore(nunits)) == 0)
-        return 0;
   }
+  if((a = (struct apage*)sbrk(size)) == (struct apage*)-1)
+    return 0;
+  a->size = size;
+  return a;
+}
+
+static void
+putapages(struct apage *a)
+{
+  struct apage *next;
+
+  for(; a; a = next){
+    next = a->next;
+    a->next = sparepages;
+    sparepages = a;
+  }
+}
+
+struct arena*
+arenacreate(void)
+{
+  struct apage *a;
+  struct arena *ar;
+
+  if((a = getapage(PGSIZE)) == 0)
+    return 0;
+  a->next = 0;
+  ar = (struct arena*)(a + 1);
+  ar->pages = a;
+  ar->p = ARENASTART(ar);
+  ar->end = (char*)a + a->size;
+  return ar;
+}
+
+void*
+arenaalloc(struct arena *ar, uint n)
+{
+  struct apage *a;
+  char *p;
+
+  n = (n + 7) & ~7;
+  if(n > ar->end - ar->p){
+    if(n > 0x7fffffff || (a = getapage(n + sizeof(*a))) == 0)
+      return 0;
+    // The new page goes second, so reset keeps the first.
+    a->next = ar->pages->next;
+    ar->pages->next = a;
+    ar->p = (char*)(a + 1);
+    ar->end = (char*)a + a->size;
+  }
+  p = ar->p;
+  ar->p += n;
+  return p;
+}
+
+void
+arenareset(struct arena *ar)
+{
+  struct apage *a = ar->pages;
+
+  putapages(a->next);
+  a->next = 0;
+  ar->p = ARENASTART(ar);
+  ar->end = (char*)a + a->size;
+}
+
+void
+arenadestroy(struct arena *ar)
+{
+  putapages(ar->pages);
 }
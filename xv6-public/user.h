@@ -1,5 +1,8 @@
 struct stat;
 struct rtcdate;
+struct lockstat;
+struct profsample;
+struct traceev;
 
 // system calls
 int fork(void);
@@ -29,17 +32,44 @@ void ps(int); //written by SeungJaeOh
 uint mmap(uint,int,int,int,int,int); //written by SeungJaeOh
 int munmap(uint); //written by SeungJaeOh
 int freemem(); //written by SeungJaeOh
+int faultaround(int);
+int msync(uint, int);
+int madvise(uint, int, int);
+int lockstat(struct lockstat*, int, int);
+int profctl(int);
+int profread(struct profsample*, int);
+int tracectl(int);
+int traceread(struct traceev*, int);
+uint ringsetup(void);
+int ringenter(void);
+int _fork(void);
+int _exit(void) __attribute__((noreturn));
+int _exec(char*, char**);
+int _close(int);
 
 // ulib.c
 int stat(const char*, struct stat*);
 char* strcpy(char*, const char*);
 void *memmove(void*, const void*, int);
+int memcmp(const void*, const void*, uint);
 char* strchr(const char*, char c);
 int strcmp(const char*, const char*);
-void printf(int, const char*, ...);
 char* gets(char*, int max);
 uint strlen(const char*);
 void* memset(void*, int, uint);
+int atoi(const char*);
+uint fineuptime(void);
+
+// umalloc.c
+struct arena;
 void* malloc(uint);
 void free(void*);
-int atoi(const char*);
+struct arena* arenacreate(void);
+void* arenaalloc(struct arena*, uint);
+void arenareset(struct arena*);
+void arenadestroy(struct arena*);
+
+// printf.c
+void printf(int, const char*, ...);
+void writebuf(int, const void*, int);
+void flush(int);
@@ -1737,6 +1737,43 @@ void argptest()
   printf(1, "arg test passed\n");
 }
 
+// the kernel must refuse to write into read-only program text,
+// rather than fault on it
+void
+textreadtest(void)
+{
+  int fd, fds[2];
+  struct stat st;
+
+  printf(stdout, "text read test\n");
+  fd = open("init", O_RDONLY);
+  if(fd < 0){
+    printf(stdout, "open init failed\n");
+    exit();
+  }
+  if(read(fd, (char*)textreadtest, 1) != -1){
+    printf(stdout, "read into text should fail\n");
+    exit();
+  }
+  if(fstat(fd, (struct stat*)textreadtest) != -1){
+    printf(stdout, "fstat into text should fail\n");
+    exit();
+  }
+  close(fd);
+  if(pipe(fds) != 0){
+    printf(stdout, "pipe() failed\n");
+    exit();
+  }
+  write(fds[1], "x", 1);
+  if(read(fds[0], (char*)textreadtest, 1) != -1 || read(fds[0], (char*)&st, 1) != 1){
+    printf(stdout, "pipe read into text should fail\n");
+    exit();
+  }
+  close(fds[0]);
+  close(fds[1]);
+  printf(stdout, "text read ok\n");
+}
+
 unsigned long randstate = 1;
 unsigned int
 rand()
@@ -1769,6 +1806,7 @@ main(int argc, char *argv[])
   bsstest();
   sbrktest();
   validatetest();
+  textreadtest();
 
   opentest();
   writetest();
@@ -0,0 +1,15 @@
+// Kernel data that user programs read with a load instead of a
+// system call. Both pages are mapped read-only into every address
+// space; VDATA is the same page everywhere, VPROC is the process's
+// own (see memlayout.h and vm.c).
+
+struct vdata {
+  uint seq;          // odd while the kernel is updating the rest
+  uint ticks;        // as returned by uptime()
+  uint tsc;          // low 32 bits of the TSC at that tick
+  uint tickcycles;   // TSC cycles per tick, averaged; 0 until known
+};
+
+struct vproc {
+  int pid;
+};
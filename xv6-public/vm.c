@@ -5,11 +5,15 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "vdata.h"
 #include "elf.h"
 
 
 
 extern char data[];  // defined by kernel.ld
+extern void sysentry(void);  // in trapasm.S
+static int sep;      // CPU has sysenter
+struct vdata *vdata; // kernel address of the VDATA page
 pde_t *kpgdir;  // for use in scheduler()
 
 // Set up CPU's kernel segment descriptors.
@@ -18,6 +22,7 @@ void
 seginit(void)
 {
   struct cpu *c;
+  uint a, b, c1, d;
 
   // Map "logical" addresses to virtual addresses using identity map.
   // Cannot share a CODE descriptor for both kernel and user
@@ -29,6 +34,18 @@ seginit(void)
   c->gdt[SEG_UCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, DPL_USER);
   c->gdt[SEG_UDATA] = SEG(STA_W, 0, 0xffffffff, DPL_USER);
   lgdt(c->gdt, sizeof(c->gdt));
+
+  // Fast system calls. sysenter loads %cs from the MSR and %ss from
+  // the next descriptor; sysexit takes the user ones from the two
+  // after that, which is the order above. The stack is set per
+  // process by switchuvm(). Without sysenter, a user sysenter is an
+  // illegal instruction, which trap() turns into a system call.
+  cpuidinfo(1, &a, &b, &c1, &d);
+  sep = (d & CPUID_SEP) != 0;
+  if(sep){
+    wrmsr(MSR_SYSENTER_CS, SEG_KCODE << 3);
+    wrmsr(MSR_SYSENTER_EIP, (uint)sysentry);
+  }
 }
 
 // Return the address of the PTE in page table pgdir
@@ -41,6 +58,9 @@ walkpgdir(pde_t *pgdir, const void *va, int alloc)
   pte_t *pgtab;
 
   pde = &pgdir[PDX(va)];
+  // a 4MB page (see mmaplarge) has no page table
+  if(*pde & PTE_PS)
+    return 0;
   if(*pde & PTE_P){
     pgtab = (pte_t*)P2V(PTE_ADDR(*pde));
   } else {
@@ -134,6 +154,11 @@ setupkvm(void)
       freevm(pgdir);
       return 0;
     }
+  // Above KERNBASE, so deallocuvm() leaves it alone.
+  if(mappages(pgdir, (void*)VDATA, PGSIZE, V2P(vdata), PTE_U) < 0){
+    freevm(pgdir);
+    return 0;
+  }
   return pgdir;
 }
 
@@ -142,10 +167,44 @@ setupkvm(void)
 void
 kvmalloc(void)
 {
+  if((vdata = (struct vdata*)kalloc()) == 0)
+    panic("kvmalloc");
+  memset(vdata, 0, PGSIZE);
   kpgdir = setupkvm();
   switchkvm();
 }
 
+// Map the kernel page page into pgdir at user address va, above
+// KERNBASE, with permissions perm.
+int
+mapupage(pde_t *pgdir, uint va, void *page, int perm)
+{
+  return mappages(pgdir, (void*)va, PGSIZE, V2P(page), perm);
+}
+
+// Publish a new value of ticks in the VDATA page, timing the tick
+// with the TSC. Called on one CPU only, with tickslock held.
+void
+vdatatick(void)
+{
+  uint tsc, c;
+
+  tsc = rdtsc();
+  vdata->seq++;
+  __sync_synchronize();
+  if(vdata->tsc != 0){
+    c = tsc - vdata->tsc;
+    if(vdata->tickcycles == 0)
+      vdata->tickcycles = c;
+    else
+      vdata->tickcycles = vdata->tickcycles - vdata->tickcycles/8 + c/8;
+  }
+  vdata->ticks = ticks;
+  vdata->tsc = tsc;
+  __sync_synchronize();
+  vdata->seq++;
+}
+
 // Switch h/w page table register to the kernel-only page table,
 // for when no process is running.
 void
@@ -171,6 +230,8 @@ switchuvm(struct proc *p)
   mycpu()->gdt[SEG_TSS].s = 0;
   mycpu()->ts.ss0 = SEG_KDATA << 3;
   mycpu()->ts.esp0 = (uint)p->kstack + KSTACKSIZE;
+  if(sep)
+    wrmsr(MSR_SYSENTER_ESP, (uint)p->kstack + KSTACKSIZE);
   // setting IOPL=0 in eflags *and* iomb beyond the tss segment limit
   // forbids I/O instructions (e.g., inb and outb) from user space
   mycpu()->ts.iomb = (ushort) 0xFFFF;
@@ -272,8 +333,10 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
       pa = PTE_ADDR(*pte);
       if(pa == 0)
         panic("kfree");
-      char *v = P2V(pa);
-      kfree(v);
+      if((*pte & PTE_U) == 0 || (*pte & PTE_W) || textput(pa) < 0){
+        char *v = P2V(pa);
+        kfree(v);
+      }
       *pte = 0;
     }
   }
@@ -325,12 +388,20 @@ copyuvm(pde_t *pgdir, uint sz)
   if((d = setupkvm()) == 0)
     return 0;
   for(i = 0; i < sz; i += PGSIZE){
-    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
-      panic("copyuvm: pte should exist");
-    if(!(*pte & PTE_P))
-      panic("copyuvm: page not present");
+    // Program pages not touched yet are left for the child to
+    // read in itself.
+    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0 || !(*pte & PTE_P))
+      continue;
     pa = PTE_ADDR(*pte);
     flags = PTE_FLAGS(*pte);
+    if((flags & PTE_U) && !(flags & PTE_W) && textdup(pa) == 0){
+      // Shared program text.
+      if(mappages(d, (void*)i, PGSIZE, pa, flags) < 0){
+        textput(pa);
+        goto bad;
+      }
+      continue;
+    }
     if((mem = kalloc()) == 0)
       goto bad;
     memmove(mem, (char*)P2V(pa), PGSIZE);